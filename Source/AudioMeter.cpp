@@ -0,0 +1,175 @@
+#include "AudioMeter.h"
+#include <cmath>
+
+//==============================================================================
+AudioMeter::AudioMeter() : fifo((size_t) fftSize, 0.0f), fftData((size_t) fftSize * 2, 0.0f)
+{
+    prepare(currentSampleRate);
+}
+
+void AudioMeter::prepare(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    fifoFill = 0;
+
+    // log spaced band edges from 20Hz up to nyquist, at least one FFT bin wide each
+    double nyquist = sampleRate / 2.0;
+    double binHz = sampleRate / fftSize;
+
+    for (int band = 0; band <= MeterSnapshot::numSpectrumBands; ++band)
+    {
+        double hz = 20.0 * std::pow(nyquist / 20.0, (double) band / MeterSnapshot::numSpectrumBands);
+        bandEdges[band] = jlimit(1, fftSize / 2, (int) (hz / binHz));
+
+        if (band > 0)
+        {
+            bandEdges[band] = jmax(bandEdges[band], jmin(fftSize / 2, bandEdges[band - 1] + 1));
+        }
+    }
+}
+
+void AudioMeter::process(const AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    auto& snapshot = snapshots.getWriteBuffer();
+    int numChannels = jmin(2, buffer.getNumChannels());
+
+    if (numChannels == 0 || numSamples <= 0)
+    {
+        return;
+    }
+
+    float decay = (float) std::pow(0.1, numSamples / currentSampleRate);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        // a mono buffer is shown on both sides
+        int source = jmin(ch, numChannels - 1);
+        auto range = FloatVectorOperations::findMinAndMax(buffer.getReadPointer(source, startSample), numSamples);
+        float blockPeak = jmax(std::abs(range.getStart()), std::abs(range.getEnd()));
+
+        heldPeak[ch] = jmax(blockPeak, heldPeak[ch] * decay);
+        snapshot.peak[ch] = heldPeak[ch];
+        snapshot.rms[ch] = buffer.getRMSLevel(source, startSample, numSamples);
+    }
+
+    // the spectrum fifo is filled a run of samples at a time rather than sample by sample
+    for (int done = 0; done < numSamples; )
+    {
+        int todo = jmin(numSamples - done, fftSize - fifoFill);
+        float* dest = fifo.data() + fifoFill;
+
+        FloatVectorOperations::copy(dest, buffer.getReadPointer(0, startSample + done), todo);
+        if (numChannels > 1)
+        {
+            FloatVectorOperations::add(dest, buffer.getReadPointer(1, startSample + done), todo);
+            FloatVectorOperations::multiply(dest, 0.5f, todo);
+        }
+
+        fifoFill += todo;
+        done += todo;
+
+        if (fifoFill == fftSize)
+        {
+            computeSpectrum();
+            fifoFill = 0;
+        }
+    }
+
+    snapshot.spectrum = latestSpectrum;
+    snapshots.publish();
+}
+
+void AudioMeter::computeSpectrum()
+{
+    FloatVectorOperations::copy(fftData.data(), fifo.data(), fftSize);
+    window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    // a full scale sine comes out of the transform at roughly a quarter of the fft size with a hann window
+    float scale = 4.0f / fftSize;
+
+    for (int band = 0; band < MeterSnapshot::numSpectrumBands; ++band)
+    {
+        int first = bandEdges[band];
+        int last = jmax(first + 1, bandEdges[band + 1]);
+        float magnitude = FloatVectorOperations::findMaximum(fftData.data() + first, jmin(last, fftSize / 2) - first) * scale;
+
+        latestSpectrum[band] = jmap(jlimit(-90.0f, 0.0f, Decibels::gainToDecibels(magnitude, -90.0f)), -90.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+bool AudioMeter::update()
+{
+    return snapshots.update();
+}
+
+const MeterSnapshot& AudioMeter::getSnapshot() const
+{
+    return snapshots.getReadBuffer();
+}
+
+//==============================================================================
+MeterComponent::MeterComponent(AudioMeter& _meter, Style _style) : meter(_meter), style(_style)
+{
+    startTimerHz(30);
+}
+
+MeterComponent::~MeterComponent()
+{
+    stopTimer();
+}
+
+void MeterComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(Colours::black);
+
+    if (style == Style::levels)
+    {
+        paintLevels(g, meter.getSnapshot());
+    }
+    else
+    {
+        paintSpectrum(g, meter.getSnapshot());
+    }
+
+    g.setColour(Colours::grey);
+    g.drawRect(getLocalBounds(), 1);
+}
+
+void MeterComponent::paintLevels(juce::Graphics& g, const MeterSnapshot& snapshot)
+{
+    float barW = getWidth() / 2.0f;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        float x = ch * barW + 1.0f;
+        float rmsH = jlimit(0.0f, 1.0f, snapshot.rms[ch]) * getHeight();
+        float peakY = getHeight() - jlimit(0.0f, 1.0f, snapshot.peak[ch]) * getHeight();
+
+        g.setColour(Colours::lightgreen);
+        g.fillRect(x, getHeight() - rmsH, barW - 2.0f, rmsH);
+
+        g.setColour(snapshot.peak[ch] >= 1.0f ? Colours::red : Colours::yellow);
+        g.fillRect(x, peakY, barW - 2.0f, 2.0f);
+    }
+}
+
+void MeterComponent::paintSpectrum(juce::Graphics& g, const MeterSnapshot& snapshot)
+{
+    float bandW = (float) getWidth() / MeterSnapshot::numSpectrumBands;
+
+    g.setColour(Colours::orange);
+
+    for (int band = 0; band < MeterSnapshot::numSpectrumBands; ++band)
+    {
+        float h = snapshot.spectrum[band] * getHeight();
+        g.fillRect(band * bandW, getHeight() - h, jmax(1.0f, bandW - 1.0f), h);
+    }
+}
+
+void MeterComponent::timerCallback()
+{
+    // several components can show the same meter, so this repaints even when another one took the update
+    meter.update();
+    repaint();
+}
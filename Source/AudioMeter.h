@@ -0,0 +1,99 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+#include <array>
+#include <vector>
+
+//==============================================================================
+/*
+    One block's worth of meter readings, as published by the audio thread.
+*/
+struct MeterSnapshot
+{
+    static constexpr int numSpectrumBands = 64;
+
+    std::array<float, 2> peak{};
+    std::array<float, 2> rms{};
+
+    /** log spaced bands from 20Hz to nyquist, 0 is -90dB and 1 is full scale */
+    std::array<float, numSpectrumBands> spectrum{};
+};
+
+//==============================================================================
+/*
+    Measures a stereo signal on the audio thread. Peak and RMS come from the
+    vector operations on each block, the spectrum from a 1024 point FFT run
+    whenever enough samples have been collected. Readings are handed to the
+    GUI through a triple buffer, so neither side ever waits for the other.
+*/
+class AudioMeter
+{
+public:
+    AudioMeter();
+
+    /** sets up the spectrum bands for a sample rate. call from prepareToPlay */
+    void prepare(double sampleRate);
+
+    /** audio thread: measures a block and publishes the readings */
+    void process(const AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    /** GUI thread: swaps in the newest readings, returns false if nothing new arrived */
+    bool update();
+    const MeterSnapshot& getSnapshot() const;
+
+private:
+    static constexpr int fftOrder = 10;
+    static constexpr int fftSize = 1 << fftOrder;
+
+    void computeSpectrum();
+
+    dsp::FFT fft{ fftOrder };
+    dsp::WindowingFunction<float> window{ (size_t) fftSize, dsp::WindowingFunction<float>::hann };
+
+    // all allocated up front, nothing on the audio thread grows
+    std::vector<float> fifo;
+    std::vector<float> fftData;
+    int fifoFill = 0;
+
+    std::array<int, MeterSnapshot::numSpectrumBands + 1> bandEdges{};
+    std::array<float, MeterSnapshot::numSpectrumBands> latestSpectrum{};
+
+    // peaks fall back slowly so the GUI sees every one, whichever blocks it happens to read
+    std::array<float, 2> heldPeak{};
+    double currentSampleRate = 44100.0;
+
+    TripleBuffer<MeterSnapshot> snapshots;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioMeter)
+};
+
+//==============================================================================
+/*
+    Draws an AudioMeter at display rate, either as stereo level bars (RMS filled,
+    peak as a line) or as a spectrum analyser.
+*/
+class MeterComponent : public juce::Component, public Timer
+{
+public:
+    enum class Style
+    {
+        levels,
+        spectrum
+    };
+
+    MeterComponent(AudioMeter& _meter, Style _style);
+    ~MeterComponent() override;
+
+    void paint(juce::Graphics&) override;
+    void timerCallback() override;
+
+private:
+    void paintLevels(juce::Graphics& g, const MeterSnapshot& snapshot);
+    void paintSpectrum(juce::Graphics& g, const MeterSnapshot& snapshot);
+
+    AudioMeter& meter;
+    Style style;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterComponent)
+};
@@ -0,0 +1,294 @@
+#include "AutoDJ.h"
+#include <cmath>
+
+//==============================================================================
+Crossfade::Crossfade()
+{
+}
+
+void Crossfade::schedule(int newFromDeck, int newToDeck, int64 startSample, int64 lengthInSamples)
+{
+    // switched off while the fields change, then published in one store
+    active.store(false);
+    fromDeck.store(newFromDeck);
+    toDeck.store(newToDeck);
+    start.store(startSample);
+    length.store(jmax((int64) 1, lengthInSamples));
+    active.store(true);
+}
+
+void Crossfade::cancel()
+{
+    active.store(false);
+}
+
+bool Crossfade::isActive() const
+{
+    return active.load();
+}
+
+int64 Crossfade::getStartSample() const
+{
+    return start.load();
+}
+
+int64 Crossfade::getEndSample() const
+{
+    return start.load() + length.load();
+}
+
+float Crossfade::getGain(int deck, int64 sampleTime) const
+{
+    double progress = jlimit(0.0, 1.0, (double) (sampleTime - start.load()) / (double) length.load());
+    double angle = progress * MathConstants<double>::halfPi;
+
+    return (float) (deck == fromDeck.load() ? std::cos(angle) : std::sin(angle));
+}
+
+void Crossfade::apply(int deck, AudioBuffer<float>& buffer, int numSamples, int64 blockStart) const
+{
+    if (!active.load() || (deck != fromDeck.load() && deck != toDeck.load()))
+    {
+        return;
+    }
+
+    // the block is split where the fade starts and ends, so both land on their exact sample
+    int64 fadeStart = start.load();
+    int64 fadeEnd = fadeStart + length.load();
+
+    int cuts[] = { 0,
+                   (int) jlimit<int64>(0, numSamples, fadeStart - blockStart),
+                   (int) jlimit<int64>(0, numSamples, fadeEnd - blockStart),
+                   numSamples };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        int from = cuts[i];
+        int to = cuts[i + 1];
+
+        if (to <= from)
+        {
+            continue;
+        }
+
+        float startGain = getGain(deck, blockStart + from);
+        float endGain = getGain(deck, blockStart + to);
+
+        if (startGain != endGain)
+        {
+            buffer.applyGainRamp(from, to - from, startGain, endGain);
+        }
+        else if (startGain != 1.0f)
+        {
+            buffer.applyGain(from, to - from, startGain);
+        }
+    }
+}
+
+//==============================================================================
+AutoDJ::AutoDJ(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, DJAudioPlayer* _player1, DJAudioPlayer* _player2, const SampleClock& _sampleClock)
+    : decks{ _deckGUI1, _deckGUI2 }, players{ _player1, _player2 }, sampleClock(_sampleClock)
+{
+    addAndMakeVisible(enableButton);
+    addAndMakeVisible(fadeSlider);
+    addAndMakeVisible(fadeLabel);
+    addAndMakeVisible(statusLabel);
+
+    enableButton.onClick = [this] {setEnabled(enableButton.getToggleState());};
+
+    // crossfade length in seconds
+    fadeSlider.setRange(2.0, 30.0);
+    fadeSlider.setValue(8.0);
+    fadeSlider.setNumDecimalPlacesToDisplay(1);
+    fadeSlider.setTextBoxStyle(Slider::TextBoxLeft, false, 40, 20);
+
+    fadeLabel.setText("FADE", dontSendNotification);
+    fadeLabel.attachToComponent(&fadeSlider, true);
+
+    updateStatus();
+}
+
+AutoDJ::~AutoDJ()
+{
+    stopTimer();
+}
+
+void AutoDJ::paint(juce::Graphics& g)
+{
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+    g.setColour(juce::Colours::grey);
+    g.drawRect(getLocalBounds(), 1);
+}
+
+void AutoDJ::resized()
+{
+    int colW = getWidth() / 4;
+    int labelW = 40;
+
+    enableButton.setBounds(0, 0, colW, getHeight());
+    fadeSlider.setBounds(colW + labelW, 0, colW * 2 - labelW, getHeight());
+    statusLabel.setBounds(colW * 3, 0, colW, getHeight());
+}
+
+void AutoDJ::enqueue(const File& file)
+{
+    queue.add(file);
+    updateStatus();
+}
+
+Crossfade& AutoDJ::getCrossfade()
+{
+    return crossfade;
+}
+
+void AutoDJ::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+
+    // a fade that has not started yet is called off. one that is already under way is left to finish
+    if (!enabled && transitionScheduled)
+    {
+        int incoming = 1 - activeDeck;
+
+        if (sampleClock.getBlockStart() < crossfade.getStartSample())
+        {
+            players[incoming]->cancelScheduledStart();
+            players[incoming]->stop();
+            crossfade.cancel();
+            transitionScheduled = false;
+        }
+    }
+
+    if (enabled || transitionScheduled)
+    {
+        startTimer(50);
+    }
+
+    updateStatus();
+}
+
+void AutoDJ::timerCallback()
+{
+    if (transitionScheduled)
+    {
+        if (sampleClock.getBlockStart() >= crossfade.getEndSample())
+        {
+            finishTransition();
+        }
+        return;
+    }
+
+    if (!enabled)
+    {
+        stopTimer();
+        return;
+    }
+
+    // nothing playing: start whatever is preloaded, or the head of the queue
+    if (activeDeck < 0 || !players[activeDeck]->isPlaying())
+    {
+        int deck = activeDeck < 0 ? 0 : 1 - activeDeck;
+
+        if (!deckLoaded[deck])
+        {
+            if (queue.isEmpty())
+            {
+                return;
+            }
+
+            loadNextOnto(deck);
+        }
+
+        if (activeDeck >= 0)
+        {
+            deckLoaded[activeDeck] = false;
+        }
+
+        activeDeck = deck;
+        players[deck]->setPosition(players[deck]->getStartInSeconds());
+        players[deck]->start();
+        updateStatus();
+        return;
+    }
+
+    // the idle deck is loaded as early as possible so its read-ahead buffer is full at the transition
+    int idle = 1 - activeDeck;
+
+    if (!deckLoaded[idle])
+    {
+        if (!queue.isEmpty())
+        {
+            loadNextOnto(idle);
+        }
+        return;
+    }
+
+    scheduleTransition();
+}
+
+void AutoDJ::loadNextOnto(int deck)
+{
+    decks[deck]->loadFile(URL{ queue.removeAndReturn(0) });
+    deckLoaded[deck] = true;
+
+    updateStatus();
+}
+
+void AutoDJ::scheduleTransition()
+{
+    auto* outgoing = players[activeDeck];
+    int incoming = 1 - activeDeck;
+
+    double speed = jmax(0.01, outgoing->getSpeed());
+    double position = outgoing->getPositionInSeconds();
+    double remaining = (outgoing->getEndInSeconds() - position) / speed;
+    double fade = fadeSlider.getValue();
+
+    // handed to the audio thread a few seconds early, so the start sample is never already gone
+    const double leadTime = 3.0;
+
+    if (remaining > fade + leadTime)
+    {
+        return;
+    }
+
+    double fadeStartIn = jmax(0.0, remaining - fade);
+
+    double sampleRate = outgoing->getSampleRate();
+    int64 startSample = sampleClock.getBlockStart() + (int64) (fadeStartIn * sampleRate);
+
+    // the incoming deck is started now but held silent by the audio thread until the start sample
+    players[incoming]->setPosition(players[incoming]->getStartInSeconds());
+    players[incoming]->scheduleStart(startSample);
+    players[incoming]->start();
+
+    crossfade.schedule(activeDeck, incoming, startSample, (int64) (fade * sampleRate));
+    transitionScheduled = true;
+
+    updateStatus();
+}
+
+void AutoDJ::finishTransition()
+{
+    int outgoing = activeDeck;
+
+    players[outgoing]->stop();
+    crossfade.cancel();
+
+    deckLoaded[outgoing] = false;
+    activeDeck = 1 - outgoing;
+    transitionScheduled = false;
+
+    if (!enabled)
+    {
+        stopTimer();
+    }
+
+    updateStatus();
+}
+
+void AutoDJ::updateStatus()
+{
+    String status = transitionScheduled ? "Fading" : (enabled ? "On" : "Off");
+    statusLabel.setText(status + ", " + String(queue.size()) + " queued", dontSendNotification);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DJAudioPlayer.h"
+#include "DeckGUI.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    An equal power crossfade between two decks, scheduled on the mixer's sample
+    clock. The message thread sets it up ahead of time and the audio thread
+    applies it to the master bus, so the fade starts and ends on exact samples.
+*/
+class Crossfade
+{
+public:
+    Crossfade();
+
+    /** message thread: fades fromDeck out and toDeck in over the given sample clock range */
+    void schedule(int fromDeck, int toDeck, int64 startSample, int64 lengthInSamples);
+    void cancel();
+
+    bool isActive() const;
+    int64 getStartSample() const;
+    int64 getEndSample() const;
+
+    /** audio thread: applies the master gain for a deck to a block rendered starting at blockStart */
+    void apply(int deck, AudioBuffer<float>& buffer, int numSamples, int64 blockStart) const;
+
+private:
+    float getGain(int deck, int64 sampleTime) const;
+
+    std::atomic<bool> active{ false };
+    std::atomic<int> fromDeck{ 0 };
+    std::atomic<int> toDeck{ 1 };
+    std::atomic<int64> start{ 0 };
+    std::atomic<int64> length{ 1 };
+};
+
+//==============================================================================
+/*
+    Auto-DJ. Plays a queue of library tracks back to back on the two decks.
+    The next track is loaded onto the idle deck as soon as it is free, so its
+    read-ahead buffer is full well before the transition, and the crossfade is
+    handed to the audio thread with a start sample a few seconds in advance.
+*/
+class AutoDJ : public juce::Component, public Timer
+{
+public:
+    AutoDJ(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, DJAudioPlayer* _player1, DJAudioPlayer* _player2, const SampleClock& _sampleClock);
+    ~AutoDJ() override;
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+    void timerCallback() override;
+
+    /** adds a track to the end of the queue */
+    void enqueue(const File& file);
+
+    Crossfade& getCrossfade();
+
+private:
+    void setEnabled(bool shouldBeEnabled);
+    void loadNextOnto(int deck);
+    void scheduleTransition();
+    void finishTransition();
+    void updateStatus();
+
+    DeckGUI* decks[2];
+    DJAudioPlayer* players[2];
+    const SampleClock& sampleClock;
+
+    Crossfade crossfade;
+
+    Array<File> queue;
+    bool deckLoaded[2]{ false, false };
+
+    bool enabled = false;
+    bool transitionScheduled = false;
+    int activeDeck = -1;
+
+    ToggleButton enableButton{ "Auto DJ" };
+    Slider fadeSlider;
+    Label fadeLabel;
+    Label statusLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AutoDJ)
+};
@@ -0,0 +1,1065 @@
+#include "Benchmarks.h"
+#include "PlaylistComponent.h"
+#include "TrackMetadataService.h"
+#include "DecoderRegistry.h"
+#include "SessionStore.h"
+#include "MidiController.h"
+#include "DuplicateIndex.h"
+#include "StemReader.h"
+#include "RealtimeCheck.h"
+#include "SamplePads.h"
+
+namespace
+{
+    void report(const String& name, double value, const String& unit)
+    {
+        std::cout << name << "," << value << "," << unit << std::endl;
+    }
+
+    double millisecondsSince(int64 startTicks)
+    {
+        return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1000.0;
+    }
+
+    int countRowButtons(Component& parent)
+    {
+        int count = 0;
+
+        for (auto* child : parent.getChildren())
+        {
+            if (dynamic_cast<RowActionButton*>(child) != nullptr)
+            {
+                ++count;
+            }
+
+            count += countRowButtons(*child);
+        }
+
+        return count;
+    }
+
+    // scrolls around libraries of very different sizes. the cost per frame and the number of
+    // live row buttons should not depend on how many tracks are in the library
+    void benchmarkPlaylistScrolling()
+    {
+        const int numFrames = 500;
+        File fakeFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+
+        TrackMetadataService metadataService;
+        TrackAnalyser trackAnalyser{ metadataService };
+
+        for (int numRows : { 1000, 50000 })
+        {
+            PlaylistComponent playlist{ nullptr, nullptr, metadataService, trackAnalyser };
+            playlist.setSize(800, 400);
+
+            for (int i = 0; i < numRows; ++i)
+            {
+                playlist.addTrack(fakeFolder.getChildFile("track " + String(i) + ".mp3"), 210.0);
+            }
+
+            auto& table = playlist.getTable();
+            table.updateContent();
+
+            Image frame(Image::RGB, playlist.getWidth(), playlist.getHeight(), true);
+            auto start = Time::getHighResolutionTicks();
+
+            for (int f = 0; f < numFrames; ++f)
+            {
+                // jump around the whole list so every frame brings new rows on screen
+                table.scrollToEnsureRowIsOnscreen((f * 7919) % numRows);
+
+                Graphics g(frame);
+                playlist.paintEntireComponent(g, false);
+            }
+
+            String suffix = "_" + String(numRows) + "_rows";
+            report("playlist_scroll_frame" + suffix, millisecondsSince(start) / numFrames, "ms");
+            report("playlist_live_row_buttons" + suffix, countRowButtons(playlist), "components");
+        }
+    }
+
+    // sorts a large library on the numeric columns. the first sort on a column builds its keys, going back
+    // to a sort order already seen is served from the cache, and filtering is a single pass over it
+    void benchmarkPlaylistSorting()
+    {
+        const int numRows = 100000;
+        File fakeFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+
+        TrackMetadataService metadataService;
+        TrackAnalyser trackAnalyser{ metadataService };
+        PlaylistComponent playlist{ nullptr, nullptr, metadataService, trackAnalyser };
+        Random random{ 1 };
+
+        for (int i = 0; i < numRows; ++i)
+        {
+            playlist.addTrack(fakeFolder.getChildFile("track " + String(random.nextInt(numRows)) + ".mp3"), 60.0 + random.nextDouble() * 540.0);
+        }
+
+        playlist.getNumRows();
+
+        auto timeSort = [&playlist](int columnId, bool forwards)
+        {
+            auto start = Time::getHighResolutionTicks();
+            playlist.sortOrderChanged(columnId, forwards);
+            playlist.getNumRows();
+            return millisecondsSince(start);
+        };
+
+        String suffix = "_" + String(numRows) + "_rows";
+        report("playlist_sort_duration_first" + suffix, timeSort(2, true), "ms");
+        report("playlist_sort_title_first" + suffix, timeSort(1, true), "ms");
+        // keys already built, so this is only the sort itself
+        report("playlist_sort_duration_again" + suffix, timeSort(2, true), "ms");
+
+        // title then duration was sorted two clicks ago
+        report("playlist_sort_cached" + suffix, timeSort(1, true), "ms");
+    }
+
+    // a library as a saved session holds it, with a hash, key and fingerprint on every track so restoring
+    // it fills every index. titles are made of a few common words, so searches match like real ones do
+    ValueTree makeSyntheticLibrary(int numTracks, Random& random)
+    {
+        static const char* const words[] = { "Night", "Drive", "Deep", "Sun", "Echo", "Bass", "Line", "Dream", "Fire", "City", "Wave", "Soul" };
+        const int numWords = (int) (sizeof(words) / sizeof(words[0]));
+
+        File fakeFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+        int64 now = Time::currentTimeMillis();
+        ValueTree library{ "LIBRARY" };
+
+        for (int i = 0; i < numTracks; ++i)
+        {
+            String artist = "Artist " + String(random.nextInt(numTracks / 10 + 1));
+            String title = String(words[random.nextInt(numWords)]) + " " + words[random.nextInt(numWords)] + " " + String(i);
+            double length = 60.0 + random.nextDouble() * 540.0;
+
+            library.appendChild(ValueTree{ "TRACK", { { "path", fakeFolder.getChildFile(artist + " - " + title + ".mp3").getFullPathName() },
+                                                      { "length", length },
+                                                      { "added", now - (int64) random.nextInt(365) * 86400000 },
+                                                      { "hash", String::toHexString(random.nextInt64()) + String::toHexString(random.nextInt64()) },
+                                                      { "key", random.nextInt(24) },
+                                                      { "fingerprint", random.nextInt64() },
+                                                      { "audible", length } } }, nullptr);
+        }
+
+        return library;
+    }
+
+    // times every library operation that grows with the number of tracks, at three library sizes. import is
+    // timed both as tracks added one by one, the way loadToLib and loadLib add them once each header is read,
+    // and as a saved library restored in one go. deletes and searches go through the same calls as the Delete
+    // button and the track finder, and each is followed by the view rebuild it causes. deletes save the
+    // library the way the app does, so their time includes what the session costs the message thread
+    void benchmarkLibraryScale()
+    {
+        const int numSearches = 200;
+        const int numDeletes = 50;
+        const int numFrames = 100;
+        const int numCells = 10000;
+        const int deleteColumn = 5;
+        const int valueColumns[] = { 1, 2, 8, 9 };
+
+        TrackMetadataService metadataService;
+        TrackAnalyser trackAnalyser{ metadataService };
+
+        for (int numTracks : { 1000, 10000, 100000 })
+        {
+            Random random{ numTracks };
+            ValueTree library = makeSyntheticLibrary(numTracks, random);
+            String suffix = "_" + String(numTracks) + "_tracks";
+
+            PlaylistComponent playlist{ nullptr, nullptr, metadataService, trackAnalyser };
+            playlist.setSize(800, 400);
+            auto& table = playlist.getTable();
+
+            auto start = Time::getHighResolutionTicks();
+
+            for (const auto& track : library)
+            {
+                playlist.addTrack(File{ track["path"].toString() }, track["length"]);
+            }
+
+            table.updateContent();
+            report("library_import_add" + suffix, millisecondsSince(start), "ms");
+
+            start = Time::getHighResolutionTicks();
+            playlist.restoreState(library);
+            playlist.getNumRows();
+            report("library_import_restore" + suffix, millisecondsSince(start), "ms");
+
+            // half the searches find a title somewhere in the library, half find nothing and scan all of it
+            StringArray queries;
+
+            for (int s = 0; s < numSearches; ++s)
+            {
+                File file{ library.getChild(random.nextInt(numTracks))["path"].toString() };
+                queries.add(s % 2 == 0 ? file.getFileNameWithoutExtension().fromFirstOccurrenceOf(" - ", false, false) : "No Such Track " + String(s));
+            }
+
+            start = Time::getHighResolutionTicks();
+            int found = 0;
+
+            for (auto& query : queries)
+            {
+                found += playlist.getTrackIndex(query) >= 0 ? 1 : 0;
+            }
+
+            report("library_search" + suffix, millisecondsSince(start) * 1000.0 / numSearches, "us");
+            report("library_search_found" + suffix, found, "queries");
+
+            start = Time::getHighResolutionTicks();
+            playlist.findTrack("dur:3:00-5:00 key:8A-9A");
+            int filteredRows = playlist.getNumRows();
+            report("library_filter" + suffix, millisecondsSince(start), "ms");
+            report("library_filter_rows" + suffix, filteredRows, "rows");
+
+            playlist.findTrack("");
+
+            auto timeSort = [&playlist](int columnId, bool forwards)
+            {
+                auto sortStart = Time::getHighResolutionTicks();
+                playlist.sortOrderChanged(columnId, forwards);
+                playlist.getNumRows();
+                return millisecondsSince(sortStart);
+            };
+
+            report("library_sort_duration" + suffix, timeSort(2, true), "ms");
+            report("library_sort_added" + suffix, timeSort(9, false), "ms");
+            report("library_sort_title" + suffix, timeSort(1, true), "ms");
+
+            File sessionFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench").getChildFile("scale-session");
+            SessionStore store{ sessionFolder };
+            playlist.onLibraryChanged = [&store, &playlist] {store.update(SessionStore::library, playlist.getStateBuilder());};
+
+            // deleted from a title sorted table, the way a user would prune it
+            start = Time::getHighResolutionTicks();
+
+            for (int d = 0; d < numDeletes; ++d)
+            {
+                playlist.handleRowAction(deleteColumn, random.nextInt(playlist.getNumRows()));
+                playlist.getNumRows();
+            }
+
+            report("library_delete" + suffix, millisecondsSince(start) / numDeletes, "ms");
+
+            // what the writer thread does with each save. flushed here, before the writer's own delay runs out
+            store.update(SessionStore::library, playlist.getStateBuilder());
+            start = Time::getHighResolutionTicks();
+            store.flush();
+            report("library_session_write" + suffix, millisecondsSince(start), "ms");
+
+            playlist.onLibraryChanged = nullptr;
+            sessionFolder.deleteRecursively();
+
+            Image frame(Image::RGB, playlist.getWidth(), playlist.getHeight(), true);
+            int numRows = playlist.getNumRows();
+
+            start = Time::getHighResolutionTicks();
+
+            for (int f = 0; f < numFrames; ++f)
+            {
+                table.scrollToEnsureRowIsOnscreen(random.nextInt(numRows));
+
+                Graphics g(frame);
+                playlist.paintEntireComponent(g, false);
+            }
+
+            report("library_repaint_frame" + suffix, millisecondsSince(start) / numFrames, "ms");
+
+            // the text cells on their own, for rows anywhere in the library
+            Graphics g(frame);
+            start = Time::getHighResolutionTicks();
+
+            for (int c = 0; c < numCells; ++c)
+            {
+                playlist.paintCell(g, random.nextInt(numRows), valueColumns[c % 5], 80, 24, false);
+            }
+
+            report("library_paint_cell" + suffix, millisecondsSince(start) * 1000.0 / numCells, "us");
+        }
+    }
+
+    // encodes a minute of noise with every backend that can write its own format, then times how
+    // fast each backend decodes it. results are in multiples of real time
+    void benchmarkDecoders()
+    {
+        const double sampleRate = 44100.0;
+        const int numSamples = (int) sampleRate * 60;
+
+        AudioBuffer<float> source(2, numSamples);
+        Random random;
+
+        for (int ch = 0; ch < source.getNumChannels(); ++ch)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                source.setSample(ch, i, random.nextFloat() * 0.5f - 0.25f);
+            }
+        }
+
+        DecoderRegistry registry;
+        registry.addBuiltInBackends();
+
+        File tempFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+        tempFolder.createDirectory();
+
+        for (auto& backend : registry.getBackends())
+        {
+            auto format = backend.create();
+            String extension = backend.extensions[0];
+            File encoded = tempFolder.getChildFile("decode" + extension);
+            encoded.deleteFile();
+
+            {
+                std::unique_ptr<FileOutputStream> out(encoded.createOutputStream());
+                std::unique_ptr<AudioFormatWriter> writer(out != nullptr ? format->createWriterFor(out.get(), sampleRate, 2, 16, {}, 0) : nullptr);
+
+                // decode-only backends such as MP3 have nothing to test against here
+                if (writer == nullptr)
+                {
+                    continue;
+                }
+
+                out.release();
+                writer->writeFromAudioSampleBuffer(source, 0, numSamples);
+            }
+
+            std::unique_ptr<AudioFormatReader> reader(format->createReaderFor(encoded.createInputStream().release(), true));
+
+            if (reader == nullptr)
+            {
+                continue;
+            }
+
+            AudioBuffer<float> block(2, 4096);
+            auto start = Time::getHighResolutionTicks();
+
+            for (int64 pos = 0; pos < reader->lengthInSamples; pos += block.getNumSamples())
+            {
+                reader->read(&block, 0, block.getNumSamples(), pos, true, true);
+            }
+
+            double seconds = millisecondsSince(start) / 1000.0;
+            double audioSeconds = reader->lengthInSamples / reader->sampleRate;
+
+            report("decode_" + backend.name.replace(" ", "_").toLowerCase() + extension.replace(".", "_"), audioSeconds / seconds, "x_realtime");
+            encoded.deleteFile();
+        }
+    }
+
+    // fills the duplicate index with random tracks and times exact and near lookups. the cost per
+    // lookup should stay flat from a thousand tracks to a hundred thousand
+    void benchmarkDuplicateIndex()
+    {
+        const int numLookups = 10000;
+        File fakeFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+
+        for (int numTracks : { 1000, 10000, 100000 })
+        {
+            DuplicateIndex index;
+            Random random(numTracks);
+            std::vector<uint64> fingerprints;
+            std::vector<double> lengths;
+            StringArray hashes;
+
+            auto start = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numTracks; ++i)
+            {
+                File file = fakeFolder.getChildFile("track " + String(i) + ".mp3");
+                uint64 fingerprint = (uint64) random.nextInt64();
+                double length = 180.0 + random.nextInt(120);
+                String hash = String::toHexString(random.nextInt64()) + String::toHexString(random.nextInt64());
+
+                index.addContentHash(file, hash);
+                index.addFingerprint(file, fingerprint, length);
+
+                fingerprints.push_back(fingerprint);
+                lengths.push_back(length);
+                hashes.add(hash);
+            }
+
+            String suffix = "_" + String(numTracks) + "_tracks";
+            report("duplicate_index_build" + suffix, millisecondsSince(start), "ms");
+
+            start = Time::getHighResolutionTicks();
+            int found = 0;
+
+            for (int i = 0; i < numLookups; ++i)
+            {
+                found += index.findExactDuplicate(hashes[random.nextInt(numTracks)]) != File() ? 1 : 0;
+            }
+
+            report("duplicate_index_exact_lookup" + suffix, millisecondsSince(start) * 1000.0 / numLookups, "us");
+
+            start = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numLookups; ++i)
+            {
+                // a re-encode: the same fingerprint with a few bits flipped
+                int original = random.nextInt(numTracks);
+                uint64 nearby = fingerprints[(size_t) original];
+                for (int flip = 0; flip < DuplicateIndex::maxFingerprintDistance; ++flip)
+                {
+                    nearby ^= (uint64) 1 << random.nextInt(64);
+                }
+
+                found += index.findNearDuplicate(nearby, lengths[(size_t) original], File()) != File() ? 1 : 0;
+            }
+
+            report("duplicate_index_near_lookup" + suffix, millisecondsSince(start) * 1000.0 / numLookups, "us");
+            report("duplicate_index_found" + suffix, found, "tracks");
+        }
+    }
+
+    // stands in for the audio device: renders both decks in real time, one block per period,
+    // draining the controller's fifo first the way MainComponent does
+    class BlockClock : public Thread
+    {
+    public:
+        BlockClock(MidiController& _controller, DJAudioPlayer& _player1, DJAudioPlayer& _player2, int _blockSize, double _sampleRate)
+            : Thread("Bench Audio"), controller(_controller), player1(_player1), player2(_player2), blockSize(_blockSize), sampleRate(_sampleRate)
+        {
+        }
+
+        void run() override
+        {
+            AudioBuffer<float> buffer(2, blockSize);
+            double periodMs = blockSize * 1000.0 / sampleRate;
+            double nextBlock = Time::getMillisecondCounterHiRes();
+
+            while (!threadShouldExit())
+            {
+                controller.processPendingEvents();
+
+                AudioSourceChannelInfo info{ &buffer, 0, blockSize };
+                player1.getNextAudioBlock(info);
+                player2.getNextAudioBlock(info);
+
+                // sleeps most of the period and spins the rest, so blocks start on time
+                nextBlock += periodMs;
+                while (Time::getMillisecondCounterHiRes() < nextBlock - 1.0)
+                {
+                    Thread::sleep(1);
+                }
+                while (Time::getMillisecondCounterHiRes() < nextBlock)
+                {
+                    Thread::yield();
+                }
+            }
+        }
+
+    private:
+        MidiController& controller;
+        DJAudioPlayer& player1;
+        DJAudioPlayer& player2;
+        int blockSize;
+        double sampleRate;
+    };
+
+    // sends volume moves into a virtual MIDI port that the controller listens on and times how long
+    // each takes to reach the start of an audio block. without virtual ports (Windows) the messages
+    // are injected straight into the controller, which leaves out the MIDI driver
+    void benchmarkMidiLatency()
+    {
+        const int blockSize = 256;
+        const double sampleRate = 44100.0;
+        const int numEvents = 200;
+
+        TrackMetadataService metadataService;
+        SampleClock sampleClock;
+        DJAudioPlayer player1{ metadataService.getFormatManager(), sampleClock };
+        DJAudioPlayer player2{ metadataService.getFormatManager(), sampleClock };
+        SmoothedParameter crossfader{ 0.5, 0.05 };
+        SamplePads samplePads;
+        MidiController controller{ player1, player2, crossfader, samplePads };
+
+        player1.prepareToPlay(blockSize, sampleRate);
+        player2.prepareToPlay(blockSize, sampleRate);
+
+        std::unique_ptr<MidiOutput> virtualPort = MidiOutput::createNewDevice("OtoDecks Benchmark");
+        bool viaPort = false;
+
+        if (virtualPort != nullptr)
+        {
+            for (auto& device : MidiInput::getAvailableDevices())
+            {
+                if (device.name.contains("OtoDecks Benchmark"))
+                {
+                    controller.setInputEnabled(device, true);
+                    viaPort = controller.isInputEnabled(device.identifier);
+                }
+            }
+        }
+
+        controller.setMapping(MidiController::getMessageKey(MidiMessage::controllerEvent(1, 7, 0)), MidiController::deck1Volume);
+
+        BlockClock audio{ controller, player1, player2, blockSize, sampleRate };
+        audio.startThread(Thread::realtimeAudioPriority);
+
+        Array<double> latencies;
+        Random random;
+
+        for (int i = 0; i < numEvents; ++i)
+        {
+            auto message = MidiMessage::controllerEvent(1, 7, i % 128);
+            int appliedBefore = controller.getNumApplied();
+            auto sent = Time::getHighResolutionTicks();
+
+            if (viaPort)
+            {
+                virtualPort->sendMessageNow(message);
+            }
+            else
+            {
+                controller.handleMessage(message);
+            }
+
+            // lost messages are left out rather than counted as a timeout
+            auto deadline = Time::getMillisecondCounterHiRes() + 1000.0;
+            while (controller.getNumApplied() == appliedBefore && Time::getMillisecondCounterHiRes() < deadline)
+            {
+                Thread::yield();
+            }
+
+            if (controller.getNumApplied() != appliedBefore)
+            {
+                latencies.add(Time::highResolutionTicksToSeconds(controller.getLastAppliedTicks() - sent) * 1000.0);
+            }
+
+            // spread over the block period so the messages land at every point in a block
+            Thread::sleep(random.nextInt(7));
+        }
+
+        audio.stopThread(1000);
+
+        if (latencies.isEmpty())
+        {
+            return;
+        }
+
+        latencies.sort();
+        double total = 0.0;
+        for (auto latency : latencies)
+        {
+            total += latency;
+        }
+
+        report("midi_to_audio_via_virtual_port", viaPort ? 1 : 0, "bool");
+        report("midi_to_audio_block_period", blockSize * 1000.0 / sampleRate, "ms");
+        report("midi_to_audio_latency_mean", total / latencies.size(), "ms");
+        report("midi_to_audio_latency_p99", latencies[(int) (latencies.size() * 0.99)], "ms");
+        report("midi_to_audio_latency_max", latencies.getLast(), "ms");
+    }
+
+    // restoring the last session is on the startup path, so it has to fit in this
+    const double sessionRestoreBudgetMs = 250.0;
+
+    // saves a session with a large library and both decks loaded part way into a track, then times
+    // bringing it all back the way the app does on launch. returns false when over budget
+    bool benchmarkSessionRestore()
+    {
+        const int numTracks = 10000;
+        const double sampleRate = 44100.0;
+
+        File tempFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+        File sessionFolder = tempFolder.getChildFile("session");
+        sessionFolder.deleteRecursively();
+        tempFolder.createDirectory();
+
+        // a real track for the decks to load, so restoring them opens and buffers it
+        File deckTrack = tempFolder.getChildFile("session-deck.wav");
+        deckTrack.deleteFile();
+        {
+            AudioBuffer<float> silence(2, (int) sampleRate * 60);
+            silence.clear();
+
+            WavAudioFormat wav;
+            std::unique_ptr<FileOutputStream> out(deckTrack.createOutputStream());
+            std::unique_ptr<AudioFormatWriter> writer(out != nullptr ? wav.createWriterFor(out.get(), sampleRate, 2, 16, {}, 0) : nullptr);
+
+            if (writer == nullptr)
+            {
+                return true;
+            }
+
+            out.release();
+            writer->writeFromAudioSampleBuffer(silence, 0, silence.getNumSamples());
+        }
+
+        TrackMetadataService metadataService;
+        TrackAnalyser trackAnalyser{ metadataService };
+        AudioThumbnailCache thumbCache{ 10 };
+
+        ValueTree library{ "LIBRARY" };
+        for (int i = 0; i < numTracks; ++i)
+        {
+            library.appendChild(ValueTree{ "TRACK", { { "path", tempFolder.getChildFile("track " + String(i) + ".mp3").getFullPathName() }, { "length", 210.0 } } }, nullptr);
+        }
+
+        ValueTree deck{ "DECK", { { "url", URL{ deckTrack }.toString(false) }, { "position", 42.0 }, { "gain", 0.8 }, { "speed", 1.0 } } };
+
+        {
+            SessionStore store{ sessionFolder };
+            auto start = Time::getHighResolutionTicks();
+
+            store.update(SessionStore::library, library);
+            store.update(SessionStore::deck1, deck);
+            store.update(SessionStore::deck2, deck);
+            store.flush();
+
+            report("session_write_" + String(numTracks) + "_tracks", millisecondsSince(start), "ms");
+        }
+
+        auto start = Time::getHighResolutionTicks();
+
+        SessionStore store{ sessionFolder };
+        auto sections = store.restore();
+
+        SampleClock sampleClock;
+        DJAudioPlayer player1{ metadataService.getFormatManager(), sampleClock };
+        DJAudioPlayer player2{ metadataService.getFormatManager(), sampleClock };
+        DeckGUI deckGUI1{ &player1, metadataService.getFormatManager(), thumbCache, trackAnalyser };
+        DeckGUI deckGUI2{ &player2, metadataService.getFormatManager(), thumbCache, trackAnalyser };
+        PlaylistComponent playlist{ &deckGUI1, &deckGUI2, metadataService, trackAnalyser };
+
+        playlist.restoreState(sections[SessionStore::library]);
+        deckGUI1.restoreState(sections[SessionStore::deck1]);
+        deckGUI2.restoreState(sections[SessionStore::deck2]);
+
+        double restoreMs = millisecondsSince(start);
+        bool withinBudget = restoreMs <= sessionRestoreBudgetMs && playlist.getNumRows() == numTracks;
+
+        report("session_restore_" + String(numTracks) + "_tracks", restoreMs, "ms");
+        report("session_restore_budget", sessionRestoreBudgetMs, "ms");
+        report("session_restore_within_budget", withinBudget ? 1 : 0, "bool");
+
+        deckTrack.deleteFile();
+        sessionFolder.deleteRecursively();
+
+        return withinBudget;
+    }
+
+    // writes a stereo sine wave, returns false if there is no wav writer
+    bool writeTone(const File& file, double sampleRate, double hz, int seconds)
+    {
+        AudioBuffer<float> tone(2, (int) sampleRate * seconds);
+
+        for (int ch = 0; ch < tone.getNumChannels(); ++ch)
+        {
+            for (int i = 0; i < tone.getNumSamples(); ++i)
+            {
+                tone.setSample(ch, i, 0.5f * (float) std::sin(MathConstants<double>::twoPi * hz * i / sampleRate));
+            }
+        }
+
+        file.deleteFile();
+
+        WavAudioFormat wav;
+        std::unique_ptr<FileOutputStream> out(file.createOutputStream());
+        std::unique_ptr<AudioFormatWriter> writer(out != nullptr ? wav.createWriterFor(out.get(), sampleRate, 2, 16, {}, 0) : nullptr);
+
+        if (writer == nullptr)
+        {
+            return false;
+        }
+
+        out.release();
+        return writer->writeFromAudioSampleBuffer(tone, 0, tone.getNumSamples());
+    }
+
+    // renders the same length of audio from a stereo track and from the same track as four stems. the stems
+    // share one read-ahead and resampler, so only the mixdown is extra
+    void benchmarkStemMixing()
+    {
+        const double sampleRate = 44100.0;
+        const int blockSize = 512;
+        const int numBlocks = 2000;
+
+        File stemFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench").getChildFile("stems");
+        stemFolder.deleteRecursively();
+        stemFolder.createDirectory();
+
+        File track = stemFolder.getChildFile("track.wav");
+        bool written = writeTone(track, sampleRate, 220.0, 30);
+
+        for (int stem = 0; stem < StemReader::numStems; ++stem)
+        {
+            written = written && writeTone(stemFolder.getChildFile("track." + StemReader::getStemName(stem) + ".wav"), sampleRate, 220.0 * (stem + 1), 30);
+        }
+
+        File plain = stemFolder.getChildFile("plain.wav");
+        written = written && track.copyFileTo(plain);
+
+        if (!written)
+        {
+            return;
+        }
+
+        TrackMetadataService metadataService;
+        AudioBuffer<float> block(2, blockSize);
+
+        SampleClock sampleClock;
+
+        for (auto& file : { plain, track })
+        {
+            DJAudioPlayer player{ metadataService.getFormatManager(), sampleClock };
+            player.prepareToPlay(blockSize, sampleRate);
+            player.loadURL(URL{ file });
+            player.setSpeed(1.02);
+            player.start();
+
+            // one stem is muted, so the ramp and the skip both get exercised
+            player.setStemGain(StemReader::vocals, 0.0);
+            Thread::sleep(200);
+
+            auto start = Time::getHighResolutionTicks();
+
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                AudioSourceChannelInfo info{ &block, 0, blockSize };
+                player.getNextAudioBlock(info);
+            }
+
+            String name = player.getNumStems() > 0 ? "deck_block_4_stems" : "deck_block_stereo";
+            report(name, millisecondsSince(start) * 1000.0 / numBlocks, "us");
+        }
+
+        stemFolder.deleteRecursively();
+    }
+
+    // plays a tone through a deck while the device is restarted at other rates and block sizes, the way
+    // AudioSourcePlayer does it. the deck must keep its place and be audible in the very first block after
+    bool benchmarkDeviceChanges()
+    {
+        const double fileRate = 44100.0;
+        const double toneHz = 440.0;
+
+        File tempFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+        tempFolder.createDirectory();
+
+        File toneFile = tempFolder.getChildFile("device-change.wav");
+
+        if (!writeTone(toneFile, fileRate, toneHz, 30))
+        {
+            return true;
+        }
+
+        TrackMetadataService metadataService;
+        SampleClock sampleClock;
+        DJAudioPlayer player{ metadataService.getFormatManager(), sampleClock };
+
+        player.prepareToPlay(512, fileRate);
+        player.loadURL(URL{ toneFile }, 5.0);
+        player.start();
+
+        // gives read-ahead time to fill before the first block
+        Thread::sleep(200);
+
+        AudioBuffer<float> block(2, 2048);
+        auto render = [&player, &block](int numSamples)
+        {
+            block.clear();
+            AudioSourceChannelInfo info{ &block, 0, numSamples };
+            player.getNextAudioBlock(info);
+            return block.getMagnitude(0, numSamples);
+        };
+
+        for (int i = 0; i < 20; ++i)
+        {
+            render(512);
+        }
+
+        struct DeviceSetup
+        {
+            double sampleRate;
+            int blockSize;
+        };
+
+        // the last setup repeats the one before, which should leave the chain untouched
+        const DeviceSetup setups[] = { { 48000.0, 256 }, { 96000.0, 64 }, { 22050.0, 1024 }, { 44100.0, 512 }, { 44100.0, 512 } };
+
+        int silentFirstBlocks = 0;
+        double worstDrift = 0.0;
+        double worstPrepareMs = 0.0;
+
+        for (auto& setup : setups)
+        {
+            double before = player.getPositionInSeconds();
+
+            auto start = Time::getHighResolutionTicks();
+            player.releaseResources();
+            player.prepareToPlay(setup.blockSize, setup.sampleRate);
+            worstPrepareMs = jmax(worstPrepareMs, millisecondsSince(start));
+
+            if (render(setup.blockSize) < 0.1f)
+            {
+                ++silentFirstBlocks;
+            }
+
+            // a handful of blocks later the deck should have moved on by exactly that much audio
+            for (int i = 1; i < 16; ++i)
+            {
+                render(setup.blockSize);
+            }
+
+            double expected = 16.0 * setup.blockSize / setup.sampleRate;
+            worstDrift = jmax(worstDrift, std::abs(player.getPositionInSeconds() - before - expected));
+        }
+
+        toneFile.deleteFile();
+
+        report("device_change_prepare_worst", worstPrepareMs, "ms");
+        report("device_change_position_drift_worst", worstDrift * 1000.0, "ms");
+        report("device_change_silent_first_blocks", silentFirstBlocks, "blocks");
+
+        // the resamplers hold back a few samples after a flush, anything past 5ms is a lost position
+        bool ok = silentFirstBlocks == 0 && worstDrift < 0.005;
+        report("device_change_ok", ok ? 1 : 0, "bool");
+
+        return ok;
+    }
+
+    // renders two decks and a library preview in low latency mode at 64 samples, the way the device callback
+    // does, inside a realtime section. in a debug build any lock or allocation on the way is counted and fails the run
+    bool benchmarkLowLatency()
+    {
+        const double sampleRate = 48000.0;
+        const int blockSize = 64;
+        const int numBlocks = 20000;
+
+        File tempFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("otodeck-bench");
+        tempFolder.createDirectory();
+
+        File toneFile = tempFolder.getChildFile("low-latency.wav");
+
+        if (!writeTone(toneFile, 44100.0, 440.0, 40))
+        {
+            return true;
+        }
+
+        TrackMetadataService metadataService;
+        SampleClock sampleClock;
+        DJAudioPlayer player1{ metadataService.getFormatManager(), sampleClock };
+        DJAudioPlayer player2{ metadataService.getFormatManager(), sampleClock };
+        DJAudioPlayer* players[] = { &player1, &player2 };
+        PreviewPlayer& preview = metadataService.getPreviewPlayer();
+        AudioBuffer<float> block(2, blockSize);
+        AudioBuffer<float> previewBlock(2, blockSize);
+
+        for (auto* player : players)
+        {
+            player->prepareToPlay(blockSize, sampleRate);
+            player->setLowLatency(true);
+            player->loadURL(URL{ toneFile });
+            player->setSpeed(1.03);
+            player->start();
+        }
+
+        preview.prepareToPlay(blockSize, sampleRate);
+        metadataService.togglePreview(toneFile);
+
+        // the decks move over to their rings as soon as the ring has caught up with the transport
+        for (int attempt = 0; attempt < 100 && !(player1.isRealtimeSafe() && player2.isRealtimeSafe()); ++attempt)
+        {
+            Thread::sleep(10);
+
+            for (auto* player : players)
+            {
+                AudioSourceChannelInfo info{ &block, 0, blockSize };
+                player->getNextAudioBlock(info);
+            }
+        }
+
+        bool onRing = player1.isRealtimeSafe() && player2.isRealtimeSafe();
+        int allocationsBefore = RealtimeCheck::getNumAllocations();
+        int locksBefore = RealtimeCheck::getNumLocks();
+
+        double worstBlockUs = 0.0;
+        int silentBlocks = 0;
+        auto start = Time::getHighResolutionTicks();
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            auto blockStart = Time::getHighResolutionTicks();
+            {
+                RealtimeCheck::ScopedRealtimeSection realtime;
+
+                for (auto* player : players)
+                {
+                    AudioSourceChannelInfo info{ &block, 0, blockSize };
+                    player->getNextAudioBlock(info);
+                }
+                sampleClock.advance(blockSize);
+
+                AudioSourceChannelInfo previewInfo{ &previewBlock, 0, blockSize };
+                preview.getNextAudioBlock(previewInfo);
+            }
+            worstBlockUs = jmax(worstBlockUs, millisecondsSince(blockStart) * 1000.0);
+
+            // a silent block is one the decoder had not reached, which a real device would hear as a dropout
+            if (block.getMagnitude(0, blockSize) < 0.1f)
+            {
+                ++silentBlocks;
+            }
+
+            // rendering runs far faster than real time, so the decoder is given a chance to keep up
+            if (b % 64 == 63)
+            {
+                Thread::yield();
+            }
+        }
+
+        double meanBlockUs = millisecondsSince(start) * 1000.0 / numBlocks;
+        preview.stop();
+        toneFile.deleteFile();
+
+        // both counts are -1 when the checker is compiled out
+        bool checked = RealtimeCheck::isActive();
+        int allocations = checked ? RealtimeCheck::getNumAllocations() - allocationsBefore : -1;
+        int locks = checked ? RealtimeCheck::getNumLocks() - locksBefore : -1;
+
+        report("low_latency_block_64_mean", meanBlockUs, "us");
+        report("low_latency_block_64_worst", worstBlockUs, "us");
+        report("low_latency_block_64_budget", blockSize * 1000000.0 / sampleRate, "us");
+        report("low_latency_silent_blocks", silentBlocks, "blocks");
+        report("low_latency_allocations", allocations, "count");
+        report("low_latency_locks", locks, "count");
+
+        bool ok = onRing && allocations <= 0 && locks <= 0;
+        report("low_latency_ok", ok ? 1 : 0, "bool");
+
+        return ok;
+    }
+
+    // schedules pad hits at odd sample times and checks each is heard on exactly that sample, then plays
+    // more hits than there are voices at 64 sample blocks inside a realtime section
+    bool benchmarkSamplePads()
+    {
+        const double sampleRate = 48000.0;
+        const int blockSize = 64;
+        const int numHits = 200;
+        const int numBlocks = 20000;
+
+        SamplePads pads;
+        pads.prepareToPlay(blockSize, sampleRate);
+
+        // a short click marks the exact start of a hit, a long tone keeps voices busy
+        auto makeSample = [sampleRate](int length)
+        {
+            auto sample = std::make_shared<SamplePads::Sample>();
+            sample->audio.setSize(2, length);
+            sample->sampleRate = sampleRate;
+
+            for (int i = 0; i < length; ++i)
+            {
+                float value = length <= blockSize ? 1.0f : 0.25f * (float) std::sin(0.05 * i);
+                sample->audio.setSample(0, i, value);
+                sample->audio.setSample(1, i, value);
+            }
+
+            return sample;
+        };
+
+        for (int pad = 0; pad < SamplePads::numPads; ++pad)
+        {
+            pads.setSample(pad, makeSample(pad == 0 ? 32 : (int) sampleRate * 2));
+        }
+
+        AudioBuffer<float> block(2, blockSize);
+        auto render = [&pads, &block]
+        {
+            AudioSourceChannelInfo info{ &block, 0, blockSize };
+            pads.getNextAudioBlock(info);
+        };
+
+        Random random{ 44 };
+        int misplacedHits = 0;
+
+        for (int hit = 0; hit < numHits; ++hit)
+        {
+            int64 due = pads.getSampleClock() + 1 + random.nextInt(blockSize * 3);
+            pads.trigger(0, 1.0f, due);
+
+            int64 heardAt = -1;
+
+            while (pads.getSampleClock() < due + blockSize * 2)
+            {
+                int64 blockStart = pads.getSampleClock();
+                render();
+
+                for (int i = 0; i < blockSize && heardAt < 0; ++i)
+                {
+                    if (block.getSample(0, i) != 0.0f)
+                    {
+                        heardAt = blockStart + i;
+                    }
+                }
+            }
+
+            if (heardAt != due)
+            {
+                ++misplacedHits;
+            }
+        }
+
+        int allocationsBefore = RealtimeCheck::getNumAllocations();
+        int locksBefore = RealtimeCheck::getNumLocks();
+        auto start = Time::getHighResolutionTicks();
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            // a new hit every few blocks keeps every voice playing, so the oldest keeps getting taken over
+            if (b % 4 == 0)
+            {
+                pads.trigger(1 + b / 4 % (SamplePads::numPads - 1), 0.8f);
+            }
+
+            RealtimeCheck::ScopedRealtimeSection realtime;
+            render();
+        }
+
+        double meanBlockUs = millisecondsSince(start) * 1000.0 / numBlocks;
+
+        bool checked = RealtimeCheck::isActive();
+        int allocations = checked ? RealtimeCheck::getNumAllocations() - allocationsBefore : -1;
+        int locks = checked ? RealtimeCheck::getNumLocks() - locksBefore : -1;
+
+        report("pads_misplaced_hits", misplacedHits, "hits");
+        report("pads_block_64_all_voices", meanBlockUs, "us");
+        report("pads_allocations", allocations, "count");
+        report("pads_locks", locks, "count");
+
+        bool ok = misplacedHits == 0 && allocations <= 0 && locks <= 0;
+        report("pads_ok", ok ? 1 : 0, "bool");
+
+        return ok;
+    }
+}
+
+int Benchmarks::run(const String& commandLine)
+{
+    // the library suite can be run on its own, it is the one to watch when the library code changes
+    if (commandLine.contains("--benchmark-library"))
+    {
+        benchmarkLibraryScale();
+        return 0;
+    }
+
+    benchmarkPlaylistScrolling();
+    benchmarkPlaylistSorting();
+    benchmarkLibraryScale();
+    benchmarkDecoders();
+    benchmarkMidiLatency();
+    benchmarkDuplicateIndex();
+    benchmarkStemMixing();
+
+    // a startup over budget, a deck that loses its place on a device change, a lock or allocation in the
+    // low latency path, or a pad hit off its sample fails the run
+    bool restoreOk = benchmarkSessionRestore();
+    bool deviceChangesOk = benchmarkDeviceChanges();
+    bool lowLatencyOk = benchmarkLowLatency();
+    bool padsOk = benchmarkSamplePads();
+
+    return restoreOk && deviceChangesOk && lowLatencyOk && padsOk ? 0 : 1;
+}
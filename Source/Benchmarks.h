@@ -0,0 +1,16 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Command line benchmarks. Start the app with --benchmark to run them instead
+    of opening the window, or with --benchmark-library for the library suite
+    alone. Every result is printed on its own line as name,value,unit so a
+    script can collect and compare runs.
+*/
+namespace Benchmarks
+{
+    /** runs the benchmarks and returns the exit code for the application */
+    int run(const String& commandLine);
+}
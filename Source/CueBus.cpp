@@ -0,0 +1,93 @@
+#include "CueBus.h"
+
+//==============================================================================
+CueBus::CueBus()
+{
+    heldPeak[0].store(0.0f);
+    heldPeak[1].store(0.0f);
+}
+
+void CueBus::prepare(int samplesPerBlockExpected, int outputLatencyInSamples)
+{
+    // the meters show the slot that is coming out of the headphones right now, not the one just rendered
+    int blocks = samplesPerBlockExpected > 0 ? outputLatencyInSamples / samplesPerBlockExpected : 0;
+    latencyInBlocks.store(jlimit(0, numMeterSlots - 1, blocks));
+}
+
+void CueBus::addToCue(AudioBuffer<float>& output, int startSample, const AudioBuffer<float>& source, int numSamples)
+{
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        int outChannel = firstCueChannel + ch;
+
+        if (outChannel < output.getNumChannels())
+        {
+            output.addFrom(outChannel, startSample, source, jmin(ch, source.getNumChannels() - 1), 0, numSamples);
+        }
+    }
+}
+
+void CueBus::measure(const AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    writeSlot = (writeSlot + 1) % numMeterSlots;
+    int heardSlot = (writeSlot - latencyInBlocks.load() + numMeterSlots) % numMeterSlots;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        int outChannel = firstCueChannel + ch;
+        peaks[writeSlot][ch] = outChannel < output.getNumChannels() ? output.getMagnitude(outChannel, startSample, numSamples) : 0.0f;
+
+        // raised with a compare and swap, so a reset from the GUI between the load and the store is never undone
+        float peak = peaks[heardSlot][ch];
+        float held = heldPeak[ch].load();
+
+        while (peak > held && !heldPeak[ch].compare_exchange_weak(held, peak))
+        {
+        }
+    }
+}
+
+float CueBus::getLevel(int channel)
+{
+    return heldPeak[channel].exchange(0.0f);
+}
+
+//==============================================================================
+CueMeter::CueMeter(CueBus& _cueBus) : cueBus(_cueBus)
+{
+    startTimerHz(30);
+}
+
+CueMeter::~CueMeter()
+{
+    stopTimer();
+}
+
+void CueMeter::paint(juce::Graphics& g)
+{
+    g.fillAll(Colours::black);
+
+    float barW = getWidth() / 2.0f;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        float barH = jlimit(0.0f, 1.0f, levels[ch]) * getHeight();
+
+        g.setColour(levels[ch] >= 1.0f ? Colours::red : Colours::lightgreen);
+        g.fillRect(ch * barW + 1.0f, getHeight() - barH, barW - 2.0f, barH);
+    }
+
+    g.setColour(Colours::grey);
+    g.drawRect(getLocalBounds(), 1);
+}
+
+void CueMeter::timerCallback()
+{
+    // the bus holds every peak since the last tick, the decay only keeps a short one on screen long enough to see
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        levels[ch] = jmax(cueBus.getLevel(ch), levels[ch] * 0.8f);
+    }
+
+    repaint();
+}
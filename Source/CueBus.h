@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/*
+    Headphone (cue) mix. The master bus goes out on the first two output
+    channels and the cue bus on the next two, so a DJ can pre-listen to any
+    deck. Decks are rendered once per callback by MainComponent and the same
+    buffer is summed into both buses.
+*/
+class CueBus
+{
+public:
+    static constexpr int firstCueChannel = 2;
+    static constexpr int numOutputChannels = 4;
+
+    CueBus();
+
+    /** call from prepareToPlay. latency is the device output latency used to line the meters up with what is heard */
+    void prepare(int samplesPerBlockExpected, int outputLatencyInSamples);
+
+    /** audio thread: mixes a rendered stereo source into the cue channels */
+    void addToCue(AudioBuffer<float>& output, int startSample, const AudioBuffer<float>& source, int numSamples);
+
+    /** audio thread: measures the cue channels once everything has been added */
+    void measure(const AudioBuffer<float>& output, int startSample, int numSamples);
+
+    /** GUI: highest peak of a cue channel since the last call, delayed by the output latency. the hold starts again from here */
+    float getLevel(int channel);
+
+private:
+    static constexpr int numMeterSlots = 64;
+
+    // each block's peak waits here until it comes out of the headphones. audio thread only
+    std::array<std::array<float, 2>, numMeterSlots> peaks{};
+    int writeSlot = 0;
+    std::atomic<int> latencyInBlocks{ 0 };
+
+    // the loudest block heard since the GUI last looked, so a peak between two repaints is never missed
+    std::array<std::atomic<float>, 2> heldPeak;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CueBus)
+};
+
+//==============================================================================
+/*
+    Stereo peak meter for the cue bus.
+*/
+class CueMeter : public juce::Component, public Timer
+{
+public:
+    CueMeter(CueBus& _cueBus);
+    ~CueMeter() override;
+
+    void paint(juce::Graphics&) override;
+    void timerCallback() override;
+
+private:
+    CueBus& cueBus;
+    std::array<float, 2> levels{ 0.0f, 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CueMeter)
+};
@@ -1,41 +1,455 @@
 #include "DJAudioPlayer.h"
 
-DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager) : formatManager(_formatManager)
+namespace
 {
+    // the record chases the hand over this long, so uneven jog events still make a smooth sweep
+    const double scratchFollowTime = 0.02;
 
+    // without a touch sensor, the hand counts as off the record once scrubbing stops for this long
+    const double scratchReleaseTime = 0.1;
+
+    // how fast the platter gets back to speed once let go, in normal speeds per second
+    const double platterTorque = 4.0;
+
+    const double maxScratchRate = 8.0;
+
+    const int readAheadSamples = 32768;
 }
 
-DJAudioPlayer::~DJAudioPlayer()
+//==============================================================================
+/*
+    The decoded read-ahead for a loaded track. It is prepared once, at the
+    file's own sample rate, and ignores the prepare and release calls the
+    transport passes down. A device restart or sample rate change therefore
+    leaves the decoded audio and the read position exactly as they were.
+
+    For a stem track every stem is buffered side by side, and mixed down to
+    stereo with its own gain as blocks are taken out. The stems share one read
+    position, and everything after this, transport and resamplers included,
+    only ever sees a single stereo stream.
+*/
+class DJAudioPlayer::ReadAhead : public PositionableAudioSource
 {
+public:
+    ReadAhead(AudioFormatReader* reader, TimeSliceThread& thread, DeckParameters& _params, int _numStems) : params(_params), numStems(_numStems), readerSource(reader, true), buffering(&readerSource, thread, false, readAheadSamples, jmax(2, _numStems * 2), false)
+    {
+        // the transport's resampler asks for blocks at the file's rate, never more than the buffer holds
+        buffering.prepareToPlay(readAheadSamples / 2, reader->sampleRate);
+        stemBlock.setSize(numStems * 2, numStems > 0 ? readAheadSamples / 4 : 0);
+    }
+
+    void prepareToPlay(int, double) override
+    {
+    }
+
+    void releaseResources() override
+    {
+    }
+
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override
+    {
+        if (numStems == 0)
+        {
+            buffering.getNextAudioBlock(bufferToFill);
+            return;
+        }
 
+        int numSamples = bufferToFill.numSamples;
+
+        // sized for any normal block up front, so this only allocates if a device asks for something huge
+        stemBlock.setSize(numStems * 2, numSamples, false, false, true);
+        buffering.getNextAudioBlock(AudioSourceChannelInfo{ &stemBlock, 0, numSamples });
+        bufferToFill.clearActiveBufferRegion();
+
+        auto& output = *bufferToFill.buffer;
+
+        for (int stem = 0; stem < numStems; ++stem)
+        {
+            auto& gain = params.stemGain[stem];
+            float startGain = (float) gain.getCurrentValue();
+            float endGain = gain.isSmoothing() ? (float) gain.skip(numSamples) : startGain;
+
+            // a muted stem costs nothing, the others are one vectorised multiply-add per channel
+            if (startGain == 0.0f && endGain == 0.0f)
+            {
+                continue;
+            }
+
+            for (int ch = 0; ch < jmin(2, output.getNumChannels()); ++ch)
+            {
+                const float* source = stemBlock.getReadPointer(stem * 2 + ch);
+
+                if (startGain == endGain)
+                {
+                    FloatVectorOperations::addWithMultiply(output.getWritePointer(ch, bufferToFill.startSample), source, startGain, numSamples);
+                }
+                else
+                {
+                    output.addFromWithRamp(ch, bufferToFill.startSample, source, numSamples, startGain, endGain);
+                }
+            }
+        }
+    }
+
+    void setNextReadPosition(int64 newPosition) override
+    {
+        buffering.setNextReadPosition(newPosition);
+    }
+
+    int64 getNextReadPosition() const override
+    {
+        return buffering.getNextReadPosition();
+    }
+
+    int64 getTotalLength() const override
+    {
+        return buffering.getTotalLength();
+    }
+
+    bool isLooping() const override
+    {
+        return buffering.isLooping();
+    }
+
+    void setLooping(bool shouldLoop) override
+    {
+        buffering.setLooping(shouldLoop);
+    }
+
+private:
+    DeckParameters& params;
+    int numStems;
+
+    AudioFormatReaderSource readerSource;
+    BufferingAudioSource buffering;
+    AudioBuffer<float> stemBlock;
+};
+
+//==============================================================================
+
+DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager, const SampleClock& _sampleClock) : formatManager(_formatManager), sampleClock(_sampleClock)
+{
+    readAheadThread.addTimeSliceClient(&scratchBuffer);
+    readAheadThread.startThread();
+}
+
+DJAudioPlayer::~DJAudioPlayer()
+{
+    readAheadThread.removeTimeSliceClient(&scratchBuffer);
+    transportSource.setSource(nullptr);
+    readAheadThread.stopThread(1000);
 }
 
 void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // the device prepares again after every restart. with nothing changed, the chain is left as it is
+    if (sampleRate == preparedSampleRate && samplesPerBlockExpected <= preparedBlockSize)
+    {
+        return;
+    }
+
+    // the record keeps spinning at the same speed, which is a different step per output sample
+    if (preparedSampleRate > 0.0)
+    {
+        scratchStep *= preparedSampleRate / sampleRate;
+    }
+
+    currentSampleRate.store(sampleRate);
+    meter.prepare(sampleRate);
+    params.gain.prepare(sampleRate);
+    params.speed.prepare(sampleRate);
+
+    for (auto& stemGain : params.stemGain)
+    {
+        stemGain.prepare(sampleRate);
+    }
+
+    // the resampler prepares the transport it reads from. at a ratio of 1 the transport is prepared at the
+    // device rate, rather than at a rate scaled by whatever speed the deck happens to be at
+    resampleSource.setResamplingRatio(1.0);
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    resampleSource.setResamplingRatio(params.speed.getCurrentValue());
+
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlockExpected;
 }
 
 void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
 {
-    resampleSource.getNextAudioBlock(bufferToFill);
+    int64 blockStart = sampleClock.getBlockStart();
+
+    scratchBuffer.startBlock();
+    applyPendingParameters(bufferToFill.numSamples);
+
+    double startGain = params.gain.getCurrentValue();
+
+    // a scheduled deck stays silent, without pulling audio, until its start sample comes round
+    AudioSourceChannelInfo region{ bufferToFill };
+    int64 startAt = scheduledStart.load();
+
+    if (startAt >= 0)
+    {
+        int offset = (int) jlimit<int64>(0, bufferToFill.numSamples, startAt - blockStart);
+        bufferToFill.buffer->clear(bufferToFill.startSample, offset);
+
+        region.startSample += offset;
+        region.numSamples -= offset;
+
+        if (region.numSamples > 0)
+        {
+            scheduledStart.compare_exchange_strong(startAt, -1);
+        }
+    }
+
+    if (region.numSamples > 0 && !renderFromRing(region))
+    {
+        // an empty deck plays silence without going near the transport
+        if (scratchBuffer.getSampleRate() > 0.0)
+        {
+            resampleSource.getNextAudioBlock(region);
+        }
+        else
+        {
+            region.clearActiveBufferRegion();
+        }
+    }
+
+    // the ring follows whichever source is playing, so vinyl or low latency mode can take over at any moment
+    double sourceRate = scratchBuffer.getSampleRate();
+    scratchBuffer.setPlayhead(ringActive ? scratchPosition : transportSource.getCurrentPosition() * sourceRate);
+
+    // gain is ramped per sample across the block so volume moves never zipper
+    if (params.gain.isSmoothing())
+    {
+        double endGain = params.gain.skip(bufferToFill.numSamples);
+        bufferToFill.buffer->applyGainRamp(bufferToFill.startSample, bufferToFill.numSamples, (float) startGain, (float) endGain);
+    }
+    else if (startGain != 1.0)
+    {
+        bufferToFill.buffer->applyGain(bufferToFill.startSample, bufferToFill.numSamples, (float) startGain);
+    }
+
+    meter.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void DJAudioPlayer::applyPendingParameters(int numSamples)
+{
+    params.gain.updateTarget();
+    params.speed.updateTarget();
+
+    for (auto& stemGain : params.stemGain)
+    {
+        stemGain.updateTarget();
+    }
+
+    // seeks are collapsed too, only the last position the slider was dragged to is used. a track loaded
+    // during this block keeps its start position until the ring has switched to it next block
+    double seek = scratchBuffer.hasPendingReader() ? -1.0 : params.pendingSeek.exchange(-1.0);
+    double nudgeBy = params.pendingNudge.exchange(0.0);
+
+    // the transport locks, so on the ring it is left alone and caught up when the deck goes back to it
+    if (!ringActive)
+    {
+        if (seek >= 0)
+        {
+            transportSource.setPosition(seek);
+        }
+
+        if (nudgeBy != 0.0)
+        {
+            transportSource.setPosition(jlimit(0.0, transportSource.getLengthInSeconds(), transportSource.getCurrentPosition() + nudgeBy));
+        }
+    }
+    else if (seek >= 0 || nudgeBy != 0.0)
+    {
+        double sourceRate = scratchBuffer.getSampleRate();
+
+        if (seek >= 0)
+        {
+            scratchPosition = seek * sourceRate;
+        }
+
+        scratchPosition = jmax(0.0, scratchPosition + nudgeBy * sourceRate);
+        scratchTarget = scratchPosition;
+    }
+
+    // the transport takes its lock and posts its change message here. on the ring it is left alone
+    int transport = params.pendingTransport.exchange(0);
+    if (transport != 0)
+    {
+        ringPlaying.store(transport > 0);
+
+        if (!ringActive)
+        {
+            if (transport > 0)
+            {
+                transportSource.start();
+            }
+            else
+            {
+                transportSource.stop();
+            }
+        }
+    }
+
+    // speed is ramped per block, the resampler interpolates within the block
+    if (params.speed.isSmoothing())
+    {
+        double ratio = params.speed.skip(numSamples);
+
+        if (!ringActive)
+        {
+            resampleSource.setResamplingRatio(ratio);
+        }
+    }
+}
+
+bool DJAudioPlayer::renderFromRing(const AudioSourceChannelInfo& region)
+{
+    double sourceRate = scratchBuffer.getSampleRate();
+    double outputRate = currentSampleRate.load();
+    bool vinyl = params.vinylMode.load();
+    bool wanted = (vinyl || params.lowLatency.load()) && sourceRate > 0.0;
+
+    if (wanted != ringActive)
+    {
+        if (wanted)
+        {
+            // taken over from the transport only once the ring has caught up, so the switch is seamless
+            double position = transportSource.getCurrentPosition() * sourceRate;
+
+            if (!scratchBuffer.isReady(position, region.numSamples))
+            {
+                return false;
+            }
+
+            ringPlaying.store(transportSource.isPlaying());
+            scratchPosition = scratchTarget = position;
+            scratchStep = ringPlaying.load() ? params.speed.getCurrentValue() * sourceRate / outputRate : 0.0;
+
+            // taken over with the hand off the record, so the deck carries straight on
+            samplesSinceScrub = (int64) (scratchReleaseTime * outputRate);
+        }
+        else
+        {
+            // everything that happened on the ring is handed back to the transport in one go
+            transportSource.setPosition(scratchPosition / sourceRate);
+            resampleSource.setResamplingRatio(params.speed.getCurrentValue());
+
+            if (ringPlaying.load())
+            {
+                transportSource.start();
+            }
+            else
+            {
+                transportSource.stop();
+            }
+        }
+
+        ringActive = wanted;
+        playingFromRing.store(wanted);
+    }
+
+    if (!ringActive)
+    {
+        return false;
+    }
+
+    double scrubbed = params.pendingScrub.exchange(0.0);
+    scratchTarget += scrubbed * sourceRate;
+    samplesSinceScrub = scrubbed != 0.0 ? 0 : samplesSinceScrub + region.numSamples;
+
+    bool held = params.scratchTouch.load() || samplesSinceScrub < (int64) (scratchReleaseTime * outputRate);
+    double maxStep = maxScratchRate * sourceRate / outputRate;
+    double endStep;
+
+    if (held)
+    {
+        // never chases faster than one block, or it would overshoot and wobble
+        double followSamples = jmax(scratchFollowTime * outputRate, 2.0 * region.numSamples);
+        endStep = jlimit(-maxStep, maxStep, (scratchTarget - scratchPosition) / followSamples);
+    }
+    else
+    {
+        // let go: the platter spins back up to the deck's speed, or down to a stop when paused. without vinyl
+        // mode there is no platter, the deck just plays at its speed
+        double restStep = ringPlaying.load() ? params.speed.getCurrentValue() * sourceRate / outputRate : 0.0;
+        double maxChange = platterTorque * sourceRate / outputRate * region.numSamples / outputRate;
+        endStep = vinyl ? scratchStep + jlimit(-maxChange, maxChange, restStep - scratchStep) : restStep;
+    }
+
+    // stem levels are applied as the ring is read, the same ramps the read-ahead would have used
+    float startGains[StemReader::numStems];
+    float endGains[StemReader::numStems];
+    bool hasStems = numStems.load() > 0;
+
+    if (hasStems)
+    {
+        for (int stem = 0; stem < StemReader::numStems; ++stem)
+        {
+            auto& gain = params.stemGain[stem];
+            startGains[stem] = (float) gain.getCurrentValue();
+            endGains[stem] = gain.isSmoothing() ? (float) gain.skip(region.numSamples) : startGains[stem];
+        }
+    }
+
+    scratchBuffer.render(*region.buffer, region.startSample, region.numSamples, scratchPosition, scratchStep, endStep,
+                         hasStems ? startGains : nullptr, hasStems ? endGains : nullptr);
+    scratchStep = endStep;
+
+    if (!held)
+    {
+        scratchTarget = scratchPosition;
+
+        // the deck stops at the end of the track, as the transport would
+        if (ringPlaying.load() && scratchPosition >= (double) scratchBuffer.getLengthInSamples())
+        {
+            ringPlaying.store(false);
+        }
+    }
+
+    ringPositionInSeconds.store(scratchPosition / sourceRate);
+    return true;
 }
 
 void DJAudioPlayer::releaseResources()
 {
-    transportSource.releaseResources();
-    resampleSource.releaseResources();
+    // called whenever the device stops or restarts. everything is kept, so the deck carries on from the
+    // same sample once the device is back. the transport lets go of its source when the deck is destroyed
 }
 
-void DJAudioPlayer::loadURL(URL audioURL)
+void DJAudioPlayer::loadURL(URL audioURL, double startPosition)
 {
-    auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
+    // a track with stems plays them instead of its own mix, so each one can be turned down on its own
+    File file = audioURL.isLocalFile() ? audioURL.getLocalFile() : File();
+    AudioFormatReader* reader = file != File() ? StemReader::create(formatManager, file) : nullptr;
+    int stems = reader != nullptr ? (int) StemReader::numStems : 0;
+
+    if (reader == nullptr)
+    {
+        reader = formatManager.createReaderFor(audioURL.createInputStream(false));
+    }
+
     if (reader != nullptr) // good file!
     {
-        std::unique_ptr<AudioFormatReaderSource> newSource(new AudioFormatReaderSource(reader,
-            true));
+        std::unique_ptr<ReadAhead> newSource(new ReadAhead(reader, readAheadThread, params, stems));
+
+        // on the ring the record is moved to the start position on the audio thread. the ring has its own
+        // copy of the stems, so their levels work there too
+        bool onRing = params.vinylMode.load() || params.lowLatency.load();
+        scratchBuffer.setReader(stems > 0 ? StemReader::create(formatManager, file) : formatManager.createReaderFor(audioURL.createInputStream(false)), stems);
+        params.pendingSeek.store(onRing ? startPosition : -1.0);
+        setPlayRange(0.0, -1.0);
         transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
-        readerSource.reset(newSource.release());
+        readAhead.reset(newSource.release());
+        numStems.store(stems);
+        ringPlaying.store(transportSource.isPlaying());
+
+        // seeked here rather than on the audio thread, so read-ahead starts buffering from this position straight away
+        if (startPosition > 0.0)
+        {
+            transportSource.setPosition(startPosition);
+        }
     }
 }
 
@@ -46,7 +460,7 @@ void DJAudioPlayer::setGain(double gain)
         std::cout << "DJAudioPlayer::setGain gain should be between 0 and 1" << std::endl;
     }
     else {
-        transportSource.setGain(gain);
+        params.gain.setTarget(gain);
     }
 }
 
@@ -56,13 +470,14 @@ void DJAudioPlayer::setSpeed(double ratio)
         std::cout << "DJAudioPlayer::setSpeed ratio should be between 0 and 10" << std::endl;
     }
     else {
-        resampleSource.setResamplingRatio(ratio);
+        params.speed.setTarget(ratio);
     }
 }
 
 void DJAudioPlayer::setPosition(double posInSecs)
 {
-    transportSource.setPosition(posInSecs);
+    // the audio thread performs the seek at the start of its next block
+    params.pendingSeek.store(posInSecs);
 }
 
 void DJAudioPlayer::setPositionRelative(double pos)
@@ -78,23 +493,195 @@ void DJAudioPlayer::setPositionRelative(double pos)
 
 void DJAudioPlayer::start()
 {
+    // both are set, whichever the deck is playing from. the audio thread never locks the transport while it is on the ring
     transportSource.start();
+    ringPlaying.store(true);
 }
 
 void DJAudioPlayer::stop()
 {
     transportSource.stop();
+    ringPlaying.store(false);
 }
 
 void DJAudioPlayer::repeat()
 {
-    setPosition(0);
-    transportSource.start();
+    setPosition(getStartInSeconds());
+    start();
+}
+
+void DJAudioPlayer::requestStart()
+{
+    params.pendingTransport.store(1);
+}
+
+void DJAudioPlayer::requestStop()
+{
+    params.pendingTransport.store(-1);
+}
+
+void DJAudioPlayer::nudge(double seconds)
+{
+    double current = params.pendingNudge.load();
+    while (!params.pendingNudge.compare_exchange_weak(current, current + seconds))
+    {
+    }
+}
+
+void DJAudioPlayer::setVinylMode(bool shouldBeVinyl)
+{
+    params.vinylMode.store(shouldBeVinyl);
+    scratchBuffer.setFilling(shouldBeVinyl || params.lowLatency.load());
+}
+
+bool DJAudioPlayer::isVinylMode() const
+{
+    return params.vinylMode.load();
+}
+
+void DJAudioPlayer::setLowLatency(bool shouldBeLowLatency)
+{
+    params.lowLatency.store(shouldBeLowLatency);
+    scratchBuffer.setFilling(shouldBeLowLatency || params.vinylMode.load());
+}
+
+bool DJAudioPlayer::isLowLatency() const
+{
+    return params.lowLatency.load();
+}
+
+bool DJAudioPlayer::isRealtimeSafe() const
+{
+    return playingFromRing.load() || scratchBuffer.getSampleRate() <= 0.0;
+}
+
+void DJAudioPlayer::setScratchTouch(bool isTouching)
+{
+    params.scratchTouch.store(isTouching);
+}
+
+void DJAudioPlayer::scrub(double seconds)
+{
+    double current = params.pendingScrub.load();
+    while (!params.pendingScrub.compare_exchange_weak(current, current + seconds))
+    {
+    }
+}
+
+int DJAudioPlayer::getNumStems() const
+{
+    return numStems.load();
+}
+
+void DJAudioPlayer::setStemGain(int stem, double gain)
+{
+    if (stem >= 0 && stem < StemReader::numStems)
+    {
+        params.stemGain[stem].setTarget(jlimit(0.0, 1.0, gain));
+    }
+}
+
+double DJAudioPlayer::getStemGain(int stem) const
+{
+    return stem >= 0 && stem < StemReader::numStems ? params.stemGain[stem].getTarget() : 0.0;
+}
+
+void DJAudioPlayer::setCued(bool shouldBeCued)
+{
+    cued.store(shouldBeCued);
+}
+
+bool DJAudioPlayer::isCued() const
+{
+    return cued.load();
+}
+
+AudioMeter& DJAudioPlayer::getMeter()
+{
+    return meter;
+}
+
+void DJAudioPlayer::scheduleStart(int64 sampleTime)
+{
+    scheduledStart.store(sampleTime);
+}
+
+void DJAudioPlayer::cancelScheduledStart()
+{
+    scheduledStart.store(-1);
+}
+
+double DJAudioPlayer::getSampleRate() const
+{
+    return currentSampleRate.load();
+}
+
+double DJAudioPlayer::getPositionInSeconds()
+{
+    return playingFromRing.load() ? ringPositionInSeconds.load() : transportSource.getCurrentPosition();
+}
+
+double DJAudioPlayer::getLengthInSeconds()
+{
+    return transportSource.getLengthInSeconds();
+}
+
+double DJAudioPlayer::getGain() const
+{
+    return params.gain.getTarget();
+}
+
+double DJAudioPlayer::getSpeed() const
+{
+    return params.speed.getTarget();
+}
+
+bool DJAudioPlayer::isPlaying() const
+{
+    return playingFromRing.load() ? ringPlaying.load() : transportSource.isPlaying();
+}
+
+void DJAudioPlayer::setPlayRange(double startInSecs, double endInSecs)
+{
+    rangeStart.store(startInSecs);
+    rangeEnd.store(endInSecs);
+}
+
+void DJAudioPlayer::setTrimSilence(bool shouldTrim)
+{
+    trimSilence.store(shouldTrim);
+}
+
+bool DJAudioPlayer::isTrimmingSilence() const
+{
+    return trimSilence.load();
+}
+
+double DJAudioPlayer::getStartInSeconds() const
+{
+    return trimSilence.load() ? rangeStart.load() : 0.0;
+}
+
+double DJAudioPlayer::getEndInSeconds()
+{
+    double end = rangeEnd.load();
+    return trimSilence.load() && end > 0.0 ? end : transportSource.getLengthInSeconds();
+}
+
+bool DJAudioPlayer::hasReachedEnd()
+{
+    // with trimming on the end is the last audible sample, otherwise the end of the file
+    if (trimSilence.load() && rangeEnd.load() > 0.0)
+    {
+        return getPositionInSeconds() >= rangeEnd.load();
+    }
+
+    return getPositionRelative() > 1;
 }
 
 double DJAudioPlayer::getPositionRelative()
 {
-    return transportSource.getCurrentPosition() / transportSource.getLengthInSeconds();
+    return getPositionInSeconds() / transportSource.getLengthInSeconds();
 }
 
 
@@ -1,18 +1,22 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckParameters.h"
+#include "AudioMeter.h"
+#include "ScratchBuffer.h"
 
 class DJAudioPlayer : public AudioSource {
 public:
 
-    DJAudioPlayer(AudioFormatManager& _formatManager);
+    DJAudioPlayer(AudioFormatManager& _formatManager, const SampleClock& _sampleClock);
     ~DJAudioPlayer();
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
     void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
     void releaseResources() override;
 
-    void loadURL(URL audioURL);
+    /** loads a track, ready to play from startPosition */
+    void loadURL(URL audioURL, double startPosition = 0.0);
     void setGain(double gain);
     void setSpeed(double ratio);
     void setPosition(double posInSecs);
@@ -22,13 +26,116 @@ public:
     void stop();
     void repeat();
 
+    /** start, stop and jog from any thread, e.g. a controller. applied at the start of the next block */
+    void requestStart();
+    void requestStop();
+    void nudge(double seconds);
+
+    /** vinyl mode plays through a decoded ring so the deck can be scratched, backwards as well as forwards */
+    void setVinylMode(bool shouldBeVinyl);
+    bool isVinylMode() const;
+
+    /** low latency mode plays through the same ring, which the audio thread reads without taking a lock */
+    void setLowLatency(bool shouldBeLowLatency);
+    bool isLowLatency() const;
+
+    /** true when the next block takes no locks: the deck is on the ring, or has nothing loaded */
+    bool isRealtimeSafe() const;
+
+    /** hand on or off the record. while it is on, the record only moves as far as it is scrubbed */
+    void setScratchTouch(bool isTouching);
+
+    /** moves the record by hand, in seconds of track. safe from any thread */
+    void scrub(double seconds);
+
+    /** holds a started deck silent until the given sample clock time, then starts it on that exact sample */
+    void scheduleStart(int64 sampleTime);
+    void cancelScheduledStart();
+
+    double getSampleRate() const;
+
+    /** number of stems the loaded track has, 0 for an ordinary stereo track */
+    int getNumStems() const;
+
+    /** level of one stem, 0-1. safe from any thread, ramped on the audio thread */
+    void setStemGain(int stem, double gain);
+    double getStemGain(int stem) const;
+
+    /** route this deck to the cue (headphone) bus as well as the master */
+    void setCued(bool shouldBeCued);
+    bool isCued() const;
+
+    /** levels and spectrum of this deck's output, measured on the audio thread */
+    AudioMeter& getMeter();
+
+    /** the audible part of the track, from analysis. used when silence trimming is on */
+    void setPlayRange(double startInSecs, double endInSecs);
+    void setTrimSilence(bool shouldTrim);
+    bool isTrimmingSilence() const;
+
+    /** where the track starts and ends, taking silence trimming into account */
+    double getStartInSeconds() const;
+    double getEndInSeconds();
+    bool hasReachedEnd();
+
     double getPositionRelative();
+    double getPositionInSeconds();
+    double getLengthInSeconds();
+    double getGain() const;
+    double getSpeed() const;
+    bool isPlaying() const;
     String getTrackDuration();
 
 private:
 
+    /** applies whatever the GUI has asked for since the last block. audio thread only */
+    void applyPendingParameters(int numSamples);
+
+    /** renders a block from the scratch ring in vinyl or low latency mode, returns false to use the transport. audio thread only */
+    bool renderFromRing(const AudioSourceChannelInfo& region);
+
+    class ReadAhead;
+
+    DeckParameters params;
+    std::atomic<bool> cued{ false };
+    std::atomic<int> numStems{ 0 };
+    AudioMeter meter;
+
+    std::atomic<int64> scheduledStart{ -1 };
+    std::atomic<double> currentSampleRate{ 44100.0 };
+
+    // what the chain was last prepared for. zero until the first prepareToPlay
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+
+    // a range end of zero or less means the range is not known yet
+    std::atomic<double> rangeStart{ 0.0 };
+    std::atomic<double> rangeEnd{ -1.0 };
+    std::atomic<bool> trimSilence{ false };
+
+    // state while playing from the ring, owned by the audio thread. positions are in source samples
+    ScratchBuffer scratchBuffer;
+    bool ringActive = false;
+    double scratchPosition = 0.0;
+    double scratchTarget = 0.0;
+    double scratchStep = 0.0;
+    int64 samplesSinceScrub = 0;
+
+    // published for the GUI while the deck plays from the ring
+    std::atomic<bool> playingFromRing{ false };
+
+    // whether the deck is playing while it is on the ring. the transport is not touched from the audio thread then
+    std::atomic<bool> ringPlaying{ false };
+    std::atomic<double> ringPositionInSeconds{ 0.0 };
+
     AudioFormatManager& formatManager;
-    std::unique_ptr<AudioFormatReaderSource> readerSource;
+
+    // shared with the other deck, scheduled starts are times on this clock
+    const SampleClock& sampleClock;
+
+    // decodes ahead of the playhead, so a loaded deck is already buffered when it starts
+    TimeSliceThread readAheadThread{ "Deck Read Ahead" };
+    std::unique_ptr<ReadAhead> readAhead;
     AudioTransportSource transportSource;
     ResamplingAudioSource resampleSource{&transportSource, false, 2};
 };
\ No newline at end of file
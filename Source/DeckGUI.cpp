@@ -4,7 +4,7 @@
 #include <fstream>
 
 //==============================================================================
-DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse) : player(_player), waveformDisplay(formatManagerToUse, cacheToUse)
+DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse, TrackAnalyser& analyserToUse) : player(_player), analyser(analyserToUse), waveformDisplay(formatManagerToUse, cacheToUse, analyserToUse), levelMeter(_player->getMeter(), MeterComponent::Style::levels)
 {
 
     // track labels
@@ -18,6 +18,9 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
     addAndMakeVisible(stopButton);
     addAndMakeVisible(loadButton);
     addAndMakeVisible(replayButton);
+    addAndMakeVisible(cueButton);
+    addAndMakeVisible(trimButton);
+    addAndMakeVisible(vinylButton);
 
     //sliders
     addAndMakeVisible(volSlider);
@@ -29,11 +32,27 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
     addAndMakeVisible(posSliderLabel);
 
     addAndMakeVisible(waveformDisplay);
+    addAndMakeVisible(levelMeter);
 
     // pointer to listeners
     playButton.addListener(this);
     stopButton.addListener(this);
     loadButton.addListener(this);
+    replayButton.addListener(this);
+    cueButton.addListener(this);
+    trimButton.addListener(this);
+    vinylButton.addListener(this);
+
+    // stems start out all on, a click mutes or brings back that stem
+    for (int stem = 0; stem < StemReader::numStems; ++stem)
+    {
+        auto& button = stemButtons[stem];
+        button.setButtonText(StemReader::getStemName(stem).substring(0, 1).toUpperCase() + StemReader::getStemName(stem).substring(1));
+        button.setClickingTogglesState(true);
+        button.setToggleState(true, dontSendNotification);
+        button.onClick = [this, stem] {player->setStemGain(stem, stemButtons[stem].getToggleState() ? 1.0 : 0.0); stateChanged();};
+        addChildComponent(button);
+    }
 
     volSlider.addListener(this);
     speedSlider.addListener(this);
@@ -63,6 +82,20 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player, AudioFormatManager& formatManagerToUse,
     speedSliderLabel.attachToComponent(&speedSlider, true);
     posSliderLabel.attachToComponent(&posSlider, true);
 
+    // in vinyl mode the waveform is the record: hold it to stop it, drag it to scratch.
+    // dragging right moves the record forward, one pixel is a few milliseconds of track
+    const double scratchSecondsPerPixel = 0.005;
+
+    waveformDisplay.onTouch = [this] {player->setScratchTouch(player->isVinylMode());};
+    waveformDisplay.onDrag = [this, scratchSecondsPerPixel](int pixels)
+    {
+        if (player->isVinylMode())
+        {
+            player->scrub(pixels * scratchSecondsPerPixel);
+        }
+    };
+    waveformDisplay.onRelease = [this] {player->setScratchTouch(false);};
+
     startTimer(500);
 }
 
@@ -84,21 +117,34 @@ void DeckGUI::resized()
     double rowW = getWidth() / 3;
 
     int labelW = 50;
+    int meterW = 20;
 
     // setting bounds for each component
     currentTrackTitle.setBounds(0, 0, getWidth() / 2, rowH);
     currentTrackDur.setBounds(getWidth() / 2, 0, getWidth() / 2, rowH);
 
-    waveformDisplay.setBounds(0, rowH, getWidth(), rowH * 2);
+    waveformDisplay.setBounds(0, rowH, getWidth() - meterW, rowH * 2);
+    levelMeter.setBounds(getWidth() - meterW, rowH, meterW, rowH * 2);
     playButton.setBounds(0, rowH * 3, rowW, rowH);
     stopButton.setBounds(rowW, rowH * 3, rowW, rowH);
-    replayButton.setBounds((2 * rowW) + (rowW / 5), rowH * 3, rowW, rowH);
+    replayButton.setBounds((2 * rowW) + (rowW / 10), rowH * 3, rowW / 2, rowH);
+    cueButton.setBounds((2 * rowW) + (rowW / 10) + (rowW / 2), rowH * 3, (rowW / 5) * 2, rowH);
 
     volSlider.setBounds(labelW, rowH * 4, getWidth() - labelW, rowH);
     speedSlider.setBounds(labelW, rowH * 5, getWidth() - labelW, rowH);
     posSlider.setBounds(labelW, rowH * 6, getWidth() - labelW, rowH);
     
-    loadButton.setBounds(0, rowH * 7, getWidth(), rowH);
+    // the stem buttons share the load row with the load button when there are stems to show
+    int loadW = stemButtons[0].isVisible() ? rowW : getWidth() - rowW;
+    loadButton.setBounds(0, rowH * 7, loadW, rowH);
+
+    for (int stem = 0; stem < StemReader::numStems; ++stem)
+    {
+        stemButtons[stem].setBounds(rowW + stem * rowW / StemReader::numStems, rowH * 7, rowW / StemReader::numStems, rowH);
+    }
+
+    trimButton.setBounds(getWidth() - rowW + 5, rowH * 7, rowW / 2 - 5, rowH);
+    vinylButton.setBounds(getWidth() - rowW / 2 + 5, rowH * 7, rowW / 2 - 5, rowH);
 }
 
 void DeckGUI::buttonClicked(Button* button)
@@ -118,6 +164,24 @@ void DeckGUI::buttonClicked(Button* button)
 
     }
 
+    if (button == &cueButton)
+    {
+        // sends the deck to the headphones as well as the master
+        player->setCued(cueButton.getToggleState());
+    }
+
+    if (button == &trimButton)
+    {
+        // skips leading and trailing silence once the track has been analysed
+        player->setTrimSilence(trimButton.getToggleState());
+    }
+
+    if (button == &vinylButton)
+    {
+        // plays through the scratch ring, so the waveform and jog wheel can scratch it
+        player->setVinylMode(vinylButton.getToggleState());
+    }
+
     if (button == &loadButton)
     {
         // prompts user to select a file. file is then processed and used in other functions to retrieve meta data such as waveform / track title
@@ -130,8 +194,12 @@ void DeckGUI::buttonClicked(Button* button)
             currentTrackTitle.setText("Playing: " + URL{ chosenFile }.getFileName().toStdString(), dontSendNotification);
             currentTrackDur.setText("Track Duration: " + player->getTrackDuration(), dontSendNotification);
             waveformDisplay.loadURL(URL{ chosenFile });
+            requestPlayRange(URL{ chosenFile });
+            stateChanged();
         });
     }
+
+    stateChanged();
 }
 
 void DeckGUI::sliderValueChanged(Slider* slider)
@@ -152,6 +220,8 @@ void DeckGUI::sliderValueChanged(Slider* slider)
     {
         player->setPositionRelative(slider->getValue());
     }
+
+    stateChanged();
 }
 
 bool DeckGUI::isInterestedInFileDrag(const StringArray& files)
@@ -166,6 +236,8 @@ void DeckGUI::filesDropped(const StringArray& files, int x, int y)
     {
         player->loadURL(URL{ File{files[0]} });
         waveformDisplay.loadURL(URL{ File{files[0]} });
+        requestPlayRange(URL{ File{files[0]} });
+        stateChanged();
     }
 }
 
@@ -176,7 +248,8 @@ void DeckGUI::timerCallback()
     waveformDisplay.setPositionRelative(player->getPositionRelative());
 
     // when the song ends, either of two outcomes are selected. if repeat is toggled, then track is left on replay
-    if (player->getPositionRelative() > 1)
+    // the end is the last audible sample when trimming, otherwise the end of the file
+    if (player->hasReachedEnd())
     {
         if (replayButton.getToggleState())
         {
@@ -189,18 +262,158 @@ void DeckGUI::timerCallback()
             player->stop();
         }
     }
+
+    // a controller can move these without going through the GUI, so they are brought back in step here
+    if (!volSlider.isMouseButtonDown())
+    {
+        volSlider.setValue(player->getGain(), dontSendNotification);
+    }
+
+    if (!speedSlider.isMouseButtonDown())
+    {
+        speedSlider.setValue(player->getSpeed(), dontSendNotification);
+    }
+
+    cueButton.setToggleState(player->isCued(), dontSendNotification);
+
+    // a playing deck's position is saved as it moves
+    if (player->isPlaying())
+    {
+        stateChanged();
+    }
+
+    if (stateDirty && onStateChanged != nullptr)
+    {
+        onStateChanged();
+    }
+
+    stateDirty = false;
 }
 
 // function to handle the incoming file url
-void DeckGUI::loadFile(URL audioURL)
+void DeckGUI::loadFile(URL audioURL, double startPosition)
 {
     // url is converted back to file
     File file = audioURL.getLocalFile();
 
-    player->loadURL(audioURL);
+    player->loadURL(audioURL, startPosition);
     waveformDisplay.loadURL(audioURL);
+    requestPlayRange(audioURL);
 
     // file if passed on to other functions to get back meta data
     currentTrackTitle.setText("Playing: " + file.getFileNameWithoutExtension(), dontSendNotification);
     currentTrackDur.setText("Track Duration: " + player->getTrackDuration(), dontSendNotification);
+    stateChanged();
+}
+
+void DeckGUI::updateStemButtons()
+{
+    bool hasStems = player->getNumStems() > 0;
+
+    for (auto& button : stemButtons)
+    {
+        button.setVisible(hasStems);
+    }
+
+    resized();
+}
+
+void DeckGUI::stateChanged()
+{
+    stateDirty = true;
+}
+
+// function to capture the deck for the session
+ValueTree DeckGUI::getState() const
+{
+    int stemMask = 0;
+    for (int stem = 0; stem < StemReader::numStems; ++stem)
+    {
+        stemMask |= stemButtons[stem].getToggleState() ? (1 << stem) : 0;
+    }
+
+    return ValueTree{ "DECK", {
+        { "url", currentURL.toString(false) },
+        { "position", player->getPositionInSeconds() },
+        { "gain", volSlider.getValue() },
+        { "speed", speedSlider.getValue() },
+        { "replay", replayButton.getToggleState() },
+        { "cue", cueButton.getToggleState() },
+        { "trim", trimButton.getToggleState() },
+        { "vinyl", vinylButton.getToggleState() },
+        { "stems", stemMask } } };
+}
+
+// function to put the deck back the way it was saved. the track is left stopped, buffered at its saved position
+void DeckGUI::restoreState(const ValueTree& state)
+{
+    if (!state.hasType("DECK"))
+    {
+        return;
+    }
+
+    // controls go through their listeners so the player picks them up too
+    volSlider.setValue(state.getProperty("gain", 1.0));
+    speedSlider.setValue(state.getProperty("speed", 1.0));
+    replayButton.setToggleState(state["replay"], sendNotification);
+    cueButton.setToggleState(state["cue"], sendNotification);
+    trimButton.setToggleState(state["trim"], sendNotification);
+    vinylButton.setToggleState(state["vinyl"], sendNotification);
+
+    // one bit per stem that is playing, everything on when the session has none saved
+    int stemMask = state.getProperty("stems", (1 << StemReader::numStems) - 1);
+
+    for (int stem = 0; stem < StemReader::numStems; ++stem)
+    {
+        stemButtons[stem].setToggleState((stemMask & (1 << stem)) != 0, dontSendNotification);
+        player->setStemGain(stem, stemButtons[stem].getToggleState() ? 1.0 : 0.0);
+    }
+
+    URL url{ state["url"].toString() };
+
+    if (url.isLocalFile() && url.getLocalFile().existsAsFile())
+    {
+        loadFile(url, state["position"]);
+    }
+
+    // what was just restored is already in the session
+    stateDirty = false;
+}
+
+// function to apply the silence analysis to the player once it is ready
+void DeckGUI::requestPlayRange(URL audioURL)
+{
+    currentURL = audioURL;
+    updateStemButtons();
+
+    if (!audioURL.isLocalFile())
+    {
+        return;
+    }
+
+    Component::SafePointer<DeckGUI> safeThis(this);
+
+    analyser.requestAnalysis(audioURL.getLocalFile(), [safeThis, audioURL](std::shared_ptr<const TrackAnalysis> analysis)
+    {
+        // the deck may have loaded something else in the meantime
+        if (safeThis == nullptr || analysis == nullptr || !(safeThis->currentURL == audioURL))
+        {
+            return;
+        }
+
+        auto* player = safeThis->player;
+        double start = analysis->samplesToSeconds(analysis->firstAudibleSample);
+        player->setPlayRange(start, analysis->samplesToSeconds(analysis->lastAudibleSample + 1));
+
+        // a freshly loaded deck is moved up to the first audible sample
+        if (player->isTrimmingSilence() && !player->isPlaying() && player->getPositionInSeconds() < start)
+        {
+            player->setPosition(start);
+        }
+
+        if (safeThis->onTrackAnalysed != nullptr)
+        {
+            safeThis->onTrackAnalysed(audioURL.getLocalFile(), analysis);
+        }
+    });
 }
\ No newline at end of file
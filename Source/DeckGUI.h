@@ -20,7 +20,7 @@
 class DeckGUI  : public juce::Component, public Button::Listener, public Slider::Listener, public FileDragAndDropTarget, public Timer
 {
 public:
-    DeckGUI(DJAudioPlayer* player, AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse);
+    DeckGUI(DJAudioPlayer* player, AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse, TrackAnalyser& analyserToUse);
     ~DeckGUI() override;
 
     void paint (juce::Graphics&) override;
@@ -37,13 +37,39 @@ public:
 
     void timerCallback() override;
     
-    void loadFile(URL audioURL);
+    void loadFile(URL audioURL, double startPosition = 0.0);
+
+    /** the loaded track, position and controls, for the session */
+    ValueTree getState() const;
+    void restoreState(const ValueTree& state);
+
+    /** called from the timer once something in getState() has changed, at most twice a second */
+    std::function<void()> onStateChanged;
+
+    /** called once the loaded track's analysis is ready */
+    std::function<void(const File&, std::shared_ptr<const TrackAnalysis>)> onTrackAnalysed;
 
 private:
+    /** fetches the track's analysis and hands its audible range to the player, and shows the stem buttons if it has stems */
+    void requestPlayRange(URL audioURL);
+
+    /** marks the session state as changed. it is reported from the timer, so a slider drag is one change */
+    void stateChanged();
+    bool stateDirty = false;
+
     TextButton playButton{ "PLAY" };
     TextButton stopButton{ "STOP" };
     TextButton loadButton{ "LOAD" };
     ToggleButton replayButton{ "Replay" };
+    ToggleButton cueButton{ "Cue" };
+    ToggleButton trimButton{ "Trim" };
+    ToggleButton vinylButton{ "Vinyl" };
+
+    // one per stem, lit while the stem is playing. only shown for tracks that have stems
+    TextButton stemButtons[StemReader::numStems];
+
+    /** shows the stem buttons when the loaded track has stems */
+    void updateStemButtons();
 
     Slider volSlider;
     Slider speedSlider;
@@ -58,8 +84,11 @@ private:
 
     FileChooser fChooser{"Select a file..."};
     DJAudioPlayer* player;
+    TrackAnalyser& analyser;
+    URL currentURL;
 
     WaveformDisplay waveformDisplay;
+    MeterComponent levelMeter;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckGUI)
 };
@@ -0,0 +1,58 @@
+#include "DeckParameters.h"
+
+//==============================================================================
+SmoothedParameter::SmoothedParameter(double initialValue, double rampLengthInSeconds) : target(initialValue), smoothed(initialValue), rampLength(rampLengthInSeconds)
+{
+}
+
+void SmoothedParameter::setTarget(double newTarget)
+{
+    target.store(newTarget, std::memory_order_relaxed);
+}
+
+double SmoothedParameter::getTarget() const
+{
+    return target.load(std::memory_order_relaxed);
+}
+
+void SmoothedParameter::prepare(double sampleRate)
+{
+    smoothed.reset(sampleRate, rampLength);
+    smoothed.setCurrentAndTargetValue(getTarget());
+}
+
+void SmoothedParameter::updateTarget()
+{
+    // only the latest value matters, any intermediate values set by the GUI are skipped
+    smoothed.setTargetValue(getTarget());
+}
+
+double SmoothedParameter::skip(int numSamples)
+{
+    return smoothed.skip(numSamples);
+}
+
+double SmoothedParameter::getCurrentValue() const
+{
+    return smoothed.getCurrentValue();
+}
+
+bool SmoothedParameter::isSmoothing() const
+{
+    return smoothed.isSmoothing();
+}
+
+//==============================================================================
+SampleClock::SampleClock()
+{
+}
+
+int64 SampleClock::getBlockStart() const
+{
+    return blockStart.load();
+}
+
+void SampleClock::advance(int numSamples)
+{
+    blockStart.store(blockStart.load() + numSamples);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StemReader.h"
+#include <atomic>
+
+//==============================================================================
+/*
+    A deck parameter shared between the message thread and the audio thread.
+    The GUI only ever stores a new target value into an atomic. The audio thread
+    picks up the latest target once per block and ramps towards it, so a slider
+    drag producing hundreds of events costs the audio thread a single load.
+*/
+class SmoothedParameter
+{
+public:
+    SmoothedParameter(double initialValue, double rampLengthInSeconds);
+
+    /** set the value to ramp towards. safe to call from any thread */
+    void setTarget(double newTarget);
+    double getTarget() const;
+
+    /** audio thread: resets the ramp for the given sample rate */
+    void prepare(double sampleRate);
+
+    /** audio thread: pulls in the most recent target. call once at the start of each block */
+    void updateTarget();
+
+    /** audio thread: advances the ramp by a block and returns the value reached */
+    double skip(int numSamples);
+
+    double getCurrentValue() const;
+    bool isSmoothing() const;
+
+private:
+    std::atomic<double> target;
+    SmoothedValue<double> smoothed;
+    double rampLength;
+};
+
+//==============================================================================
+/*
+    The mixer's sample clock, counting samples rendered since the app started.
+    Both decks take their block start from this one clock and the mixer moves
+    it on once the whole block is rendered, so a time scheduled against one
+    deck falls on the same sample of output as it does on the other.
+*/
+class SampleClock
+{
+public:
+    SampleClock();
+
+    /** sample clock time of the block being rendered, or of the next one between callbacks */
+    int64 getBlockStart() const;
+
+    /** audio thread: called once everything reading the clock has rendered the block */
+    void advance(int numSamples);
+
+private:
+    std::atomic<int64> blockStart{ 0 };
+};
+
+//==============================================================================
+/*
+    All the parameters a deck exposes to the GUI.
+*/
+struct DeckParameters
+{
+    SmoothedParameter gain{ 1.0, 0.05 };
+    SmoothedParameter speed{ 1.0, 0.1 };
+
+    /** level of each stem on a stem track. ramped quickly, so a mute lands on the beat without a click */
+    SmoothedParameter stemGain[StemReader::numStems]{ { 1.0, 0.02 }, { 1.0, 0.02 }, { 1.0, 0.02 }, { 1.0, 0.02 } };
+
+    /** seek requested by the GUI, in seconds. negative when there is nothing to do */
+    std::atomic<double> pendingSeek{ -1.0 };
+
+    /** jog moves not yet applied, in seconds. they add up until the next block */
+    std::atomic<double> pendingNudge{ 0.0 };
+
+    /** start (1) or stop (-1) requested from outside the message thread, 0 when there is nothing to do */
+    std::atomic<int> pendingTransport{ 0 };
+
+    /** vinyl mode: the deck plays from the scratch ring and follows the jog wheel */
+    std::atomic<bool> vinylMode{ false };
+
+    /** low latency mode: the deck plays from the scratch ring at its normal speed, so the audio thread never locks */
+    std::atomic<bool> lowLatency{ false };
+
+    /** the jog wheel or waveform is being held */
+    std::atomic<bool> scratchTouch{ false };
+
+    /** how far the hand has moved the record since the last block, in seconds */
+    std::atomic<double> pendingScrub{ 0.0 };
+};
@@ -0,0 +1,86 @@
+#include "DecoderRegistry.h"
+#include <algorithm>
+
+//==============================================================================
+DecoderRegistry::DecoderRegistry()
+{
+}
+
+void DecoderRegistry::addBuiltInBackends()
+{
+    // the same set registerBasicFormats() gives, but each one can now be outranked
+    addBackend({ "JUCE WAV", { ".wav", ".bwf" }, 10, [] { return std::make_unique<WavAudioFormat>(); } });
+    addBackend({ "JUCE AIFF", { ".aiff", ".aif" }, 10, [] { return std::make_unique<AiffAudioFormat>(); } });
+
+   #if JUCE_USE_FLAC
+    addBackend({ "JUCE FLAC", { ".flac" }, 10, [] { return std::make_unique<FlacAudioFormat>(); } });
+   #endif
+
+   #if JUCE_USE_OGGVORBIS
+    addBackend({ "JUCE Ogg Vorbis", { ".ogg" }, 10, [] { return std::make_unique<OggVorbisAudioFormat>(); } });
+   #endif
+
+   #if JUCE_USE_MP3AUDIOFORMAT
+    addBackend({ "JUCE MP3", { ".mp3" }, 10, [] { return std::make_unique<MP3AudioFormat>(); } });
+   #endif
+
+    // the system decoders are native code, so they win over the portable ones for anything they share
+   #if JUCE_MAC || JUCE_IOS
+    addBackend({ "CoreAudio", { ".m4a", ".aac", ".mp3", ".caf" }, 20, [] { return std::make_unique<CoreAudioFormat>(); } });
+   #endif
+
+   #if JUCE_WINDOWS && JUCE_USE_WINDOWS_MEDIA_FORMAT
+    addBackend({ "Windows Media", { ".wma", ".asf" }, 20, [] { return std::make_unique<WindowsMediaAudioFormat>(); } });
+   #endif
+}
+
+void DecoderRegistry::addBackend(const Backend& backend)
+{
+    backends.push_back(backend);
+}
+
+const std::vector<DecoderRegistry::Backend>& DecoderRegistry::getBackends() const
+{
+    return backends;
+}
+
+const DecoderRegistry::Backend* DecoderRegistry::getFastestBackendFor(const String& extension) const
+{
+    const Backend* fastest = nullptr;
+
+    for (auto& backend : backends)
+    {
+        if (backend.extensions.contains(extension, true) && (fastest == nullptr || backend.speedRank > fastest->speedRank))
+        {
+            fastest = &backend;
+        }
+    }
+
+    return fastest;
+}
+
+void DecoderRegistry::registerInto(AudioFormatManager& formatManager) const
+{
+    std::vector<const Backend*> winners;
+
+    for (auto& backend : backends)
+    {
+        for (auto& extension : backend.extensions)
+        {
+            if (getFastestBackendFor(extension) == &backend)
+            {
+                winners.push_back(&backend);
+                break;
+            }
+        }
+    }
+
+    // the manager tries formats in registration order, so where a loser shares a winner's
+    // extension the faster one still gets the first go
+    std::stable_sort(winners.begin(), winners.end(), [](const Backend* a, const Backend* b) {return a->speedRank > b->speedRank;});
+
+    for (auto* backend : winners)
+    {
+        formatManager.registerFormat(backend->create().release(), formatManager.getNumKnownFormats() == 0);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/*
+    Knows every decoder implementation the app was built with. Several backends
+    can claim the same file extension, each with a speed rank, and only the
+    fastest one for an extension is handed to the AudioFormatManager. A faster
+    decoder is added by registering another backend with a higher rank.
+*/
+class DecoderRegistry
+{
+public:
+    struct Backend
+    {
+        String name;
+        StringArray extensions;  // with the dot, e.g. ".flac"
+        int speedRank;            // higher is faster
+        std::function<std::unique_ptr<AudioFormat>()> create;
+    };
+
+    DecoderRegistry();
+
+    /** adds the decoders that come with JUCE for this platform */
+    void addBuiltInBackends();
+
+    void addBackend(const Backend& backend);
+    const std::vector<Backend>& getBackends() const;
+
+    /** the fastest backend claiming an extension, or nullptr if there is none */
+    const Backend* getFastestBackendFor(const String& extension) const;
+
+    /** registers every backend that is the fastest for at least one extension, fastest first */
+    void registerInto(AudioFormatManager& formatManager) const;
+
+private:
+    std::vector<Backend> backends;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecoderRegistry)
+};
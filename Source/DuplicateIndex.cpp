@@ -0,0 +1,184 @@
+#include "DuplicateIndex.h"
+#include <algorithm>
+
+//==============================================================================
+DuplicateIndex::DuplicateIndex()
+{
+}
+
+DuplicateIndex::~DuplicateIndex()
+{
+    hashPool.removeAllJobs(true, 4000);
+}
+
+void DuplicateIndex::requestContentHash(const File& file, HashCallback callback)
+{
+    hashPool.addJob([file, callback]
+    {
+        String hash = file.existsAsFile() ? MD5(file).toHexString() : String();
+        MessageManager::callAsync([callback, hash] {callback(hash);});
+    });
+}
+
+File DuplicateIndex::addContentHash(const File& file, const String& contentHash)
+{
+    if (contentHash.isEmpty())
+    {
+        return {};
+    }
+
+    File existing = findExactDuplicate(contentHash);
+
+    // a copy is not indexed, the track it copies stands for both
+    if (existing != File() && existing != file)
+    {
+        return existing;
+    }
+
+    String path = file.getFullPathName();
+    entries[path].contentHash = contentHash;
+    pathByContent[contentHash] = path;
+
+    return {};
+}
+
+File DuplicateIndex::addFingerprint(const File& file, uint64 fingerprint, double lengthInSeconds)
+{
+    String path = file.getFullPathName();
+    auto& entry = entries[path];
+
+    if (entry.hasFingerprint)
+    {
+        removeFingerprint(path, entry);
+    }
+
+    entry.fingerprint = fingerprint;
+    entry.lengthInSeconds = lengthInSeconds;
+    entry.hasFingerprint = true;
+
+    for (int slice = 0; slice < numSlices; ++slice)
+    {
+        pathsBySlice[getSliceKey(fingerprint, slice)].push_back(path);
+    }
+
+    return findNearDuplicate(fingerprint, lengthInSeconds, file);
+}
+
+File DuplicateIndex::findExactDuplicate(const String& contentHash) const
+{
+    auto it = pathByContent.find(contentHash);
+    return it != pathByContent.end() ? File(it->second) : File();
+}
+
+File DuplicateIndex::findNearDuplicate(uint64 fingerprint, double lengthInSeconds, const File& fileToIgnore) const
+{
+    String ignore = fileToIgnore.getFullPathName();
+
+    // within maxFingerprintDistance bits, at least one slice is off by a bit or less. so every slice
+    // is looked up as it is and with each of its 16 bits flipped, a fixed 68 finds whatever the library size
+    static_assert(maxFingerprintDistance < numSlices * 2, "a near match could be missed by every slice");
+
+    for (int probe = 0; probe < numSlices * 17; ++probe)
+    {
+        int slice = probe / 17;
+        int flip = probe % 17;
+        uint64 probed = flip == 0 ? fingerprint : fingerprint ^ ((uint64) 1 << (slice * 16 + flip - 1));
+
+        auto bucket = pathsBySlice.find(getSliceKey(probed, slice));
+
+        if (bucket == pathsBySlice.end())
+        {
+            continue;
+        }
+
+        for (auto& path : bucket->second)
+        {
+            if (path == ignore || dismissed.count(ignore < path ? std::make_pair(ignore, path) : std::make_pair(path, ignore)) > 0)
+            {
+                continue;
+            }
+
+            auto& entry = entries.at(path);
+
+            // the same recording trimmed a little differently still matches, a different edit does not
+            bool similarLength = std::abs(entry.lengthInSeconds - lengthInSeconds) <= jmax(1.0, lengthInSeconds * 0.01);
+
+            if (similarLength && countNumberOfBits(entry.fingerprint ^ fingerprint) <= maxFingerprintDistance)
+            {
+                return File(path);
+            }
+        }
+    }
+
+    return {};
+}
+
+void DuplicateIndex::remove(const File& file)
+{
+    String path = file.getFullPathName();
+    auto it = entries.find(path);
+
+    if (it == entries.end())
+    {
+        return;
+    }
+
+    if (it->second.hasFingerprint)
+    {
+        removeFingerprint(path, it->second);
+    }
+
+    auto content = pathByContent.find(it->second.contentHash);
+    if (content != pathByContent.end() && content->second == path)
+    {
+        pathByContent.erase(content);
+    }
+
+    entries.erase(it);
+}
+
+void DuplicateIndex::dismiss(const File& file, const File& similar)
+{
+    String path = file.getFullPathName();
+    String other = similar.getFullPathName();
+
+    dismissed.insert(path < other ? std::make_pair(path, other) : std::make_pair(other, path));
+}
+
+void DuplicateIndex::clear()
+{
+    entries.clear();
+    pathByContent.clear();
+    pathsBySlice.clear();
+    dismissed.clear();
+}
+
+int DuplicateIndex::size() const
+{
+    return (int) entries.size();
+}
+
+uint32 DuplicateIndex::getSliceKey(uint64 fingerprint, int slice)
+{
+    // the slice number goes in the top bits so equal values in different slices do not share a bucket
+    return ((uint32) slice << 16) | (uint32) ((fingerprint >> (slice * 16)) & 0xffff);
+}
+
+void DuplicateIndex::removeFingerprint(const String& path, const Entry& entry)
+{
+    for (int slice = 0; slice < numSlices; ++slice)
+    {
+        auto bucket = pathsBySlice.find(getSliceKey(entry.fingerprint, slice));
+
+        if (bucket != pathsBySlice.end())
+        {
+            auto& paths = bucket->second;
+            paths.erase(std::remove(paths.begin(), paths.end(), path), paths.end());
+
+            if (paths.empty())
+            {
+                pathsBySlice.erase(bucket);
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+//==============================================================================
+/*
+    Finds tracks that are already in the library. Exact copies are matched on
+    an MD5 of the whole file, hashed on background threads during import.
+    Near copies, such as the same recording at another bitrate or in another
+    format, are matched on the acoustic fingerprint from the track analysis:
+    the fingerprint is split into four 16 bit slices and each slice is
+    indexed, so a lookup only compares against the handful of tracks sharing a
+    slice rather than the whole library. Both lookups take a fixed number of
+    hash map finds.
+*/
+class DuplicateIndex
+{
+public:
+    using HashCallback = std::function<void(const String& contentHash)>;
+
+    /** fingerprints this many bits apart or fewer count as the same recording */
+    static constexpr int maxFingerprintDistance = 6;
+
+    DuplicateIndex();
+    ~DuplicateIndex();
+
+    /** hashes the whole file on a background thread and calls back on the message thread. the hash is empty if the file could not be read */
+    void requestContentHash(const File& file, HashCallback callback);
+
+    /** indexes a file's contents. returns the file already indexed with the same contents, or File() if there is none */
+    File addContentHash(const File& file, const String& contentHash);
+
+    /** indexes a file's fingerprint. returns a different file that sounds the same, or File() if there is none */
+    File addFingerprint(const File& file, uint64 fingerprint, double lengthInSeconds);
+
+    File findExactDuplicate(const String& contentHash) const;
+    File findNearDuplicate(uint64 fingerprint, double lengthInSeconds, const File& fileToIgnore) const;
+
+    /** the user has said these two are different recordings, so they are never matched with each other again */
+    void dismiss(const File& file, const File& similar);
+
+    void remove(const File& file);
+    void clear();
+    int size() const;
+
+private:
+    struct Entry
+    {
+        String contentHash;
+        uint64 fingerprint = 0;
+        double lengthInSeconds = 0.0;
+        bool hasFingerprint = false;
+    };
+
+    static constexpr int numSlices = 4;
+
+    static uint32 getSliceKey(uint64 fingerprint, int slice);
+    void removeFingerprint(const String& path, const Entry& entry);
+
+    // everything is keyed on the full path. touched on the message thread only
+    std::unordered_map<String, Entry> entries;
+    std::unordered_map<String, String> pathByContent;
+    std::unordered_map<uint32, std::vector<String>> pathsBySlice;
+
+    // dismissed pairs, the lower path first. kept after either file goes, they cost next to nothing
+    std::set<std::pair<String, String>> dismissed;
+
+    // declared last so it is destroyed first, stopping jobs before the maps go away
+    ThreadPool hashPool{ jmax(1, SystemStats::getNumCpus() / 2) };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DuplicateIndex)
+};
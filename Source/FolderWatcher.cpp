@@ -0,0 +1,239 @@
+#include "FolderWatcher.h"
+
+#if JUCE_LINUX
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+FolderWatcher::FolderWatcher(const String& _audioWildcard) : Thread("Folder Watcher"), audioWildcard(_audioWildcard)
+{
+   #if JUCE_LINUX
+    inotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   #endif
+
+    // create the weak reference's shared pointer here, so postChange only ever copies it from the watch thread
+    WeakReference<FolderWatcher> selfReference(this);
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    stopThread(2000);
+
+   #if JUCE_LINUX
+    if (inotifyHandle >= 0)
+    {
+        close(inotifyHandle);
+    }
+   #endif
+}
+
+void FolderWatcher::addFolder(const File& folder)
+{
+    if (!folder.isDirectory())
+    {
+        return;
+    }
+
+    {
+        const ScopedLock sl(foldersLock);
+
+        if (folders.contains(folder))
+        {
+            return;
+        }
+
+        folders.add(folder);
+
+       #if JUCE_LINUX
+        if (inotifyHandle >= 0)
+        {
+            // close-write rather than create, so a file being copied in is only reported once it is complete
+            int wd = inotify_add_watch(inotifyHandle, folder.getFullPathName().toRawUTF8(),
+                                       IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+            if (wd >= 0)
+            {
+                watchDescriptors[wd] = folder;
+            }
+        }
+       #endif
+
+        // the polling fallback compares against this, so files already there are not reported
+        for (const auto& entry : RangedDirectoryIterator(folder, false, audioWildcard, File::findFiles))
+        {
+            auto path = entry.getFile().getFullPathName();
+            snapshot[path] = lastScan[path] = { entry.getFileSize(), entry.getModificationTime().toMilliseconds() };
+        }
+    }
+
+    if (!isThreadRunning())
+    {
+        startThread();
+    }
+}
+
+Array<File> FolderWatcher::getFolders() const
+{
+    const ScopedLock sl(foldersLock);
+    return folders;
+}
+
+void FolderWatcher::run()
+{
+    if (inotifyHandle >= 0)
+    {
+        runInotify();
+    }
+    else
+    {
+        runPolling();
+    }
+}
+
+void FolderWatcher::runInotify()
+{
+   #if JUCE_LINUX
+    alignas(inotify_event) char buffer[4096];
+
+    while (!threadShouldExit())
+    {
+        // short timeout so the thread notices when it is asked to stop
+        pollfd pfd{ inotifyHandle, POLLIN, 0 };
+
+        if (poll(&pfd, 1, 250) <= 0)
+        {
+            continue;
+        }
+
+        auto length = read(inotifyHandle, buffer, sizeof(buffer));
+
+        for (char* ptr = buffer; length > 0 && ptr < buffer + length; )
+        {
+            auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            if (event->len == 0)
+            {
+                continue;
+            }
+
+            File folder;
+            {
+                const ScopedLock sl(foldersLock);
+                auto it = watchDescriptors.find(event->wd);
+
+                if (it == watchDescriptors.end())
+                {
+                    continue;
+                }
+
+                folder = it->second;
+            }
+
+            File file = folder.getChildFile(String::fromUTF8(event->name));
+
+            if (!isAudioFile(file))
+            {
+                continue;
+            }
+
+            if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+            {
+                postChange(file, FileChange::removed);
+            }
+            else
+            {
+                postChange(file, FileChange::written);
+            }
+        }
+    }
+   #endif
+}
+
+void FolderWatcher::runPolling()
+{
+    while (!threadShouldExit())
+    {
+        wait(2000);
+
+        if (threadShouldExit())
+        {
+            return;
+        }
+
+        std::map<String, std::pair<int64, int64>> current;
+        Array<File> scanned = getFolders();
+
+        for (auto& folder : scanned)
+        {
+            for (const auto& entry : RangedDirectoryIterator(folder, false, audioWildcard, File::findFiles))
+            {
+                current[entry.getFile().getFullPathName()] = { entry.getFileSize(), entry.getModificationTime().toMilliseconds() };
+            }
+        }
+
+        const ScopedLock sl(foldersLock);
+
+        // new files, or ones whose size or modification time moved, have been written. a file still being
+        // copied in keeps moving, so it is only reported once two scans in a row agree, as inotify waits for the close
+        for (auto& file : current)
+        {
+            auto reported = snapshot.find(file.first);
+            auto previous = lastScan.find(file.first);
+
+            if ((reported == snapshot.end() || reported->second != file.second)
+                && previous != lastScan.end() && previous->second == file.second)
+            {
+                postChange(File(file.first), FileChange::written);
+                snapshot[file.first] = file.second;
+            }
+        }
+
+        // a folder added while this scan was running is not in current yet, its files are carried over as they are
+        for (auto it = snapshot.begin(); it != snapshot.end(); )
+        {
+            if (current.find(it->first) != current.end() || !scanned.contains(File(it->first).getParentDirectory()))
+            {
+                ++it;
+                continue;
+            }
+
+            postChange(File(it->first), FileChange::removed);
+            it = snapshot.erase(it);
+        }
+
+        for (auto& file : lastScan)
+        {
+            if (!scanned.contains(File(file.first).getParentDirectory()))
+            {
+                current.insert(file);
+            }
+        }
+
+        lastScan.swap(current);
+    }
+}
+
+bool FolderWatcher::isAudioFile(const File& file) const
+{
+    // the wildcard is in "*.mp3;*.wav" form, hasFileExtension wants ".mp3;.wav"
+    return file.hasFileExtension(audioWildcard.removeCharacters("*"));
+}
+
+void FolderWatcher::postChange(const File& file, FileChange change)
+{
+    WeakReference<FolderWatcher> watcher(this);
+
+    MessageManager::callAsync([watcher, file, change]
+    {
+        // the watcher may have been deleted before the message thread got round to this
+        if (auto* w = watcher.get())
+        {
+            if (w->onFileChanged != nullptr)
+            {
+                w->onFileChanged(file, change);
+            }
+        }
+    });
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <map>
+
+//==============================================================================
+/*
+    Watches music folders for audio files being added, changed or removed.
+    On Linux this blocks on inotify, elsewhere it falls back to comparing
+    folder snapshots every couple of seconds. Either way a file is reported
+    once it is complete, not while it is still being written. Changes are
+    delivered on the message thread through onFileChanged.
+*/
+class FolderWatcher : private Thread
+{
+public:
+    enum class FileChange
+    {
+        written,    // created, moved in or modified
+        removed
+    };
+
+    FolderWatcher(const String& _audioWildcard);
+    ~FolderWatcher() override;
+
+    /** starts watching a folder. files already in it are not reported */
+    void addFolder(const File& folder);
+    Array<File> getFolders() const;
+
+    /** called on the message thread for every audio file that changes */
+    std::function<void(const File&, FileChange)> onFileChanged;
+
+private:
+    void run() override;
+    void runInotify();
+    void runPolling();
+
+    bool isAudioFile(const File& file) const;
+    void postChange(const File& file, FileChange change);
+
+    String audioWildcard;
+    Array<File> folders;
+    CriticalSection foldersLock;
+
+    // file size and modification time, used by the polling fallback. snapshot is what has been reported,
+    // lastScan what the previous scan saw. a change is only reported once both scans agree on it
+    std::map<String, std::pair<int64, int64>> snapshot;
+    std::map<String, std::pair<int64, int64>> lastScan;
+
+    int inotifyHandle = -1;
+    std::map<int, File> watchDescriptors;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(FolderWatcher)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FolderWatcher)
+};
@@ -0,0 +1,128 @@
+#include "HarmonicIndex.h"
+#include <algorithm>
+
+//==============================================================================
+HarmonicIndex::HarmonicIndex()
+{
+}
+
+HarmonicIndex::~HarmonicIndex()
+{
+}
+
+int HarmonicIndex::getKeyFromTonic(int pitchClass, bool isMajor)
+{
+    // a minor key sits beside its relative major, three semitones up. the wheel then goes round in
+    // fifths, with C major at 8B
+    int majorTonic = isMajor ? pitchClass : (pitchClass + 3) % 12;
+    int number = ((majorTonic * 7) % 12 + 7) % 12;
+
+    return number * 2 + (isMajor ? 1 : 0);
+}
+
+String HarmonicIndex::getKeyName(int key)
+{
+    if (key < 0 || key >= numKeys)
+    {
+        return "-";
+    }
+
+    return String(key / 2 + 1) + (key % 2 == 0 ? "A" : "B");
+}
+
+int HarmonicIndex::parseKeyName(const String& name)
+{
+    int number = name.getIntValue();
+    juce_wchar letter = CharacterFunctions::toUpperCase(name.getLastCharacter());
+
+    if (number < 1 || number > 12 || (letter != 'A' && letter != 'B'))
+    {
+        return -1;
+    }
+
+    return (number - 1) * 2 + (letter == 'B' ? 1 : 0);
+}
+
+std::array<int, HarmonicIndex::numCompatibleKeys> HarmonicIndex::getCompatibleKeys(int key)
+{
+    int number = key / 2;
+    int letter = key % 2;
+
+    return { key, ((number + 1) % 12) * 2 + letter, ((number + 11) % 12) * 2 + letter, key ^ 1 };
+}
+
+void HarmonicIndex::add(const File& file, int key)
+{
+    if (key < 0 || key >= numKeys)
+    {
+        return;
+    }
+
+    // a file analysed again moves to its new bucket
+    remove(file);
+
+    String path = file.getFullPathName();
+    keyByPath[path] = key;
+    pathsByKey[(size_t) key].push_back(path);
+}
+
+void HarmonicIndex::remove(const File& file)
+{
+    String path = file.getFullPathName();
+    auto it = keyByPath.find(path);
+
+    if (it == keyByPath.end())
+    {
+        return;
+    }
+
+    auto& paths = pathsByKey[(size_t) it->second];
+    paths.erase(std::remove(paths.begin(), paths.end(), path), paths.end());
+    keyByPath.erase(it);
+}
+
+void HarmonicIndex::clear()
+{
+    keyByPath.clear();
+
+    for (auto& paths : pathsByKey)
+    {
+        paths.clear();
+    }
+}
+
+int HarmonicIndex::getKey(const File& file) const
+{
+    auto it = keyByPath.find(file.getFullPathName());
+    return it != keyByPath.end() ? it->second : -1;
+}
+
+Array<File> HarmonicIndex::findCompatible(int key, const File& fileToIgnore) const
+{
+    Array<File> result;
+
+    if (key < 0 || key >= numKeys)
+    {
+        return result;
+    }
+
+    String ignore = fileToIgnore.getFullPathName();
+
+    for (int compatible : getCompatibleKeys(key))
+    {
+        for (auto& path : pathsByKey[(size_t) compatible])
+        {
+            if (path != ignore)
+            {
+                result.add(File(path));
+            }
+        }
+    }
+
+    return result;
+}
+
+int HarmonicIndex::size() const
+{
+    return (int) keyByPath.size();
+}
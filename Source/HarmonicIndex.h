@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+//==============================================================================
+/*
+    Keys of the tracks in the library, for harmonic mixing. Keys are positions
+    on the Camelot wheel, 1A 1B 2A ... 12B stored as 0-23. Two keys mix cleanly
+    when they are the same, one step apart round the wheel with the same letter,
+    or the relative major and minor. Tracks are bucketed by key, so finding the
+    compatible tracks reads four buckets instead of scanning the library.
+*/
+class HarmonicIndex
+{
+public:
+    static constexpr int numKeys = 24;
+    static constexpr int numCompatibleKeys = 4;
+
+    HarmonicIndex();
+    ~HarmonicIndex();
+
+    /** the wheel position of a key from its tonic, 0 for C up to 11 for B */
+    static int getKeyFromTonic(int pitchClass, bool isMajor);
+
+    /** 8A, 12B and so on, or - for an unknown key */
+    static String getKeyName(int key);
+
+    /** the key for a name such as 8A, or -1 if it is not one */
+    static int parseKeyName(const String& name);
+
+    /** the key itself, its neighbours either side and its relative major or minor */
+    static std::array<int, numCompatibleKeys> getCompatibleKeys(int key);
+
+    void add(const File& file, int key);
+    void remove(const File& file);
+    void clear();
+
+    /** the key a file was indexed with, or -1 */
+    int getKey(const File& file) const;
+
+    /** every indexed file that mixes with the given key, apart from fileToIgnore */
+    Array<File> findCompatible(int key, const File& fileToIgnore) const;
+
+    int size() const;
+
+private:
+    // keyed on the full path. touched on the message thread only
+    std::unordered_map<String, int> keyByPath;
+    std::array<std::vector<String>, numKeys> pathsByKey;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HarmonicIndex)
+};
@@ -10,6 +10,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainComponent.h"
+#include "Benchmarks.h"
 
 //==============================================================================
 class OtoDecksApplication  : public JUCEApplication
@@ -26,6 +27,14 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
+        // benchmarks run headless and quit straight away
+        if (commandLine.contains("--benchmark"))
+        {
+            setApplicationReturnValue(Benchmarks::run(commandLine));
+            quit();
+            return;
+        }
+
         mainWindow.reset (new MainWindow (getApplicationName()));
     }
 
@@ -1,5 +1,11 @@
 #include "MainComponent.h"
 
+// level of a deck for a crossfader position. each side only starts to fall once the fader passes the middle
+static float getCrossfaderGain(int deck, double position)
+{
+    return (float) jmin(1.0, 2.0 * (deck == 0 ? 1.0 - position : position));
+}
+
 //==============================================================================
 MainComponent::MainComponent()
 {
@@ -12,54 +18,302 @@ MainComponent::MainComponent()
         && ! RuntimePermissions::isGranted (RuntimePermissions::recordAudio))
     {
         RuntimePermissions::request (RuntimePermissions::recordAudio,
-                                     [&] (bool granted) { if (granted)  setAudioChannels (2, 2); });
+                                     [&] (bool granted) { if (granted)  setAudioChannels (2, CueBus::numOutputChannels); });
     }  
     else
     {
         // Specify the number of input and output channels that we want to open
-        setAudioChannels (0, 2);
+        // channels 1-2 carry the master, 3-4 the cue bus for headphones
+        setAudioChannels (0, CueBus::numOutputChannels);
     }
 
     addAndMakeVisible(deckGUI1);
     addAndMakeVisible(deckGUI2);
+    addAndMakeVisible(cueMeter);
+    addAndMakeVisible(masterLevels);
+    addAndMakeVisible(masterSpectrum);
 
     addAndMakeVisible(playlistComponent);
+    addAndMakeVisible(samplePadsComponent);
+    addAndMakeVisible(autoDJ);
+    addAndMakeVisible(crossfaderSlider);
+    addAndMakeVisible(midiButton);
+    addAndMakeVisible(lowLatencyButton);
+    addAndMakeVisible(latencyLabel);
+
+    crossfaderSlider.setRange(0.0, 1.0);
+    crossfaderSlider.setValue(0.5);
+    crossfaderSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    crossfaderSlider.onValueChange = [this] {crossfader.setTarget(crossfaderSlider.getValue());};
+
+    midiButton.onClick = [this] {showMidiMappings();};
+
+    lowLatencyButton.setClickingTogglesState(true);
+    lowLatencyButton.setTooltip("Low latency: 64 sample buffer, lock-free audio path");
+    lowLatencyButton.onClick = [this] {setLowLatency(lowLatencyButton.getToggleState());};
+    latencyLabel.setFont(Font(12.0f));
+    latencyLabel.setJustificationType(Justification::centred);
 
-    formatManager.registerBasicFormats();
+    // queued tracks are crossfaded over the fade length set on the auto-DJ
+    playlistComponent.onQueueTrack = [this](const File& file) {autoDJ.enqueue(file);};
+
+    // the library suggests what to mix into whatever each deck is playing
+    deckGUI1.onTrackAnalysed = [this](const File& file, std::shared_ptr<const TrackAnalysis> analysis) {playlistComponent.setDeckTrack(0, file, analysis->camelotKey);};
+    deckGUI2.onTrackAnalysed = [this](const File& file, std::shared_ptr<const TrackAnalysis> analysis) {playlistComponent.setDeckTrack(1, file, analysis->camelotKey);};
+
+    restoreSession();
+    startTimer(100);
 }
 
 MainComponent::~MainComponent()
 {
+    stopTimer();
+
+    if (midiWindow != nullptr)
+    {
+        delete midiWindow.getComponent();
+    }
+
+    // positions move all the time, so the decks are captured once more on the way out, along with any
+    // analysis results the library has not reported yet
+    playlistComponent.flushLibraryChange();
+    sessionStore.update(SessionStore::deck1, deckGUI1.getState());
+    sessionStore.update(SessionStore::deck2, deckGUI2.getState());
+    sessionStore.flush();
+
     // This shuts down the audio device and clears the audio source.
     shutdownAudio();
 }
 
+void MainComponent::restoreSession()
+{
+    auto sections = sessionStore.restore();
+
+    playlistComponent.restoreState(sections[SessionStore::library]);
+    deckGUI1.restoreState(sections[SessionStore::deck1]);
+    deckGUI2.restoreState(sections[SessionStore::deck2]);
+    midiController.restoreState(sections[SessionStore::midi]);
+    samplePadsComponent.restoreState(sections[SessionStore::pads]);
+
+    // hooked up after restoring, so putting the session back does not write it out again
+    playlistComponent.onLibraryChanged = [this] {sessionStore.update(SessionStore::library, playlistComponent.getStateBuilder());};
+    deckGUI1.onStateChanged = [this] {sessionStore.update(SessionStore::deck1, deckGUI1.getState());};
+    deckGUI2.onStateChanged = [this] {sessionStore.update(SessionStore::deck2, deckGUI2.getState());};
+    samplePadsComponent.onStateChanged = [this] {sessionStore.update(SessionStore::pads, samplePadsComponent.getState());};
+}
+
+void MainComponent::showMidiMappings()
+{
+    if (midiWindow != nullptr)
+    {
+        midiWindow->toFront(true);
+        return;
+    }
+
+    auto* panel = new MidiMappingPanel(midiController);
+    panel->onChange = [this] {sessionStore.update(SessionStore::midi, midiController.getState());};
+
+    DialogWindow::LaunchOptions options;
+    options.content.setOwned(panel);
+    options.dialogTitle = "MIDI";
+    options.useNativeTitleBar = true;
+    options.resizable = false;
+
+    midiWindow = options.launchAsync();
+}
+
+void MainComponent::setLowLatency(bool shouldBeLowLatency)
+{
+    auto setup = deviceManager.getAudioDeviceSetup();
+
+    // the buffer size picked before is put back when the mode is turned off
+    if (shouldBeLowLatency)
+    {
+        normalBufferSize = setup.bufferSize;
+        setup.bufferSize = lowLatencyBufferSize;
+    }
+    else if (normalBufferSize > 0)
+    {
+        setup.bufferSize = normalBufferSize;
+    }
+
+    // the decks move onto their rings before the callback starts checking for locks
+    player1.setLowLatency(shouldBeLowLatency);
+    player2.setLowLatency(shouldBeLowLatency);
+
+    String error = deviceManager.setAudioDeviceSetup(setup, true);
+    if (error.isNotEmpty())
+    {
+        std::cout << "MainComponent::setLowLatency " << error << std::endl;
+    }
+
+    lowLatency.store(shouldBeLowLatency);
+    lateCallbacks.store(0);
+    worstLoad.store(0.0f);
+    updateLatencyLabel();
+}
+
+void MainComponent::updateLatencyLabel()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+
+    if (device == nullptr || device->getCurrentSampleRate() <= 0.0)
+    {
+        latencyLabel.setText("no device", dontSendNotification);
+        return;
+    }
+
+    // output latency is what the driver reports on top of the buffer itself
+    int bufferSize = device->getCurrentBufferSizeSamples();
+    double latencyMs = (bufferSize + device->getOutputLatencyInSamples()) * 1000.0 / device->getCurrentSampleRate();
+    int xruns = jmax(0, device->getXRunCount()) + lateCallbacks.load();
+
+    latencyLabel.setText(String(bufferSize) + " smp, " + String(latencyMs, 1) + " ms\n"
+                         + String(xruns) + " xruns, " + String(roundToInt(worstLoad.load() * 100.0f)) + "% peak", dontSendNotification);
+}
+
+void MainComponent::timerCallback()
+{
+    if (!crossfaderSlider.isMouseButtonDown())
+    {
+        crossfaderSlider.setValue(crossfader.getTarget(), dontSendNotification);
+    }
+
+    updateLatencyLabel();
+}
+
 //==============================================================================
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
-    mixerSource.addInputSource(&player1, false);
-    mixerSource.addInputSource(&player2, false);
+    // called again on every device change. the decks keep their tracks and positions, only the
+    // per-block state below is rebuilt, and the scratch buffer only ever grows
+    deckBuffer.setSize(2, samplesPerBlockExpected, false, false, true);
 
-    //mixerSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    int outputLatency = 0;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+    {
+        outputLatency = device->getOutputLatencyInSamples();
+    }
+    cueBus.prepare(samplesPerBlockExpected, outputLatency);
+    masterMeter.prepare(sampleRate);
+    crossfader.prepare(sampleRate);
+    ticksPerSample.store((double) Time::getHighResolutionTicksPerSecond() / sampleRate);
 
     player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
     player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    metadataService.getPreviewPlayer().prepareToPlay(samplesPerBlockExpected, sampleRate);
+    samplePads.prepareToPlay(samplesPerBlockExpected, sampleRate);
  }
 void MainComponent::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill)
 {
-    mixerSource.getNextAudioBlock(bufferToFill);
+    int64 callbackStart = Time::getHighResolutionTicks();
+
+    // in low latency mode nothing below may lock or allocate, once the decks have moved onto their rings.
+    // debug builds stop on the first thing that does
+    RealtimeCheck::ScopedRealtimeSection realtime(lowLatency.load() && player1.isRealtimeSafe() && player2.isRealtimeSafe());
+
+    bufferToFill.clearActiveBufferRegion();
+
+    auto& output = *bufferToFill.buffer;
+    int numSamples = bufferToFill.numSamples;
+
+    // the device may ask for more than it promised, grow without freeing in that case
+    deckBuffer.setSize(2, numSamples, false, false, true);
+
+    // controller moves since the last block reach the decks before they render
+    midiController.processPendingEvents();
+
+    crossfader.updateTarget();
+    double faderStart = crossfader.getCurrentValue();
+    double faderEnd = crossfader.isSmoothing() ? crossfader.skip(numSamples) : faderStart;
+
+    DJAudioPlayer* players[] = { &player1, &player2 };
+    int64 blockStart = sampleClock.getBlockStart();
+
+    for (int deck = 0; deck < 2; ++deck)
+    {
+        // each deck is rendered exactly once and then routed to both buses
+        auto* player = players[deck];
+
+        AudioSourceChannelInfo deckInfo{ &deckBuffer, 0, numSamples };
+        player->getNextAudioBlock(deckInfo);
+
+        // the cue bus listens before the crossfade, so an incoming track can be heard before it is faded in
+        if (player->isCued())
+        {
+            cueBus.addToCue(output, bufferToFill.startSample, deckBuffer, numSamples);
+        }
+
+        autoDJ.getCrossfade().apply(deck, deckBuffer, numSamples, blockStart);
+
+        float startGain = getCrossfaderGain(deck, faderStart);
+        float endGain = getCrossfaderGain(deck, faderEnd);
+
+        if (startGain != endGain)
+        {
+            deckBuffer.applyGainRamp(0, numSamples, startGain, endGain);
+        }
+        else if (startGain != 1.0f)
+        {
+            deckBuffer.applyGain(0, numSamples, startGain);
+        }
+
+        for (int ch = 0; ch < jmin(2, output.getNumChannels()); ++ch)
+        {
+            output.addFrom(ch, bufferToFill.startSample, deckBuffer, ch, 0, numSamples);
+        }
+    }
+
+    // moved on only once both decks have rendered, so they always see the same block start
+    sampleClock.advance(numSamples);
+
+    // pads go straight to the master, past the crossfader, so a drop lands whichever deck is live
+    AudioSourceChannelInfo padInfo{ &deckBuffer, 0, numSamples };
+    samplePads.getNextAudioBlock(padInfo);
+
+    for (int ch = 0; ch < jmin(2, output.getNumChannels()); ++ch)
+    {
+        output.addFrom(ch, bufferToFill.startSample, deckBuffer, ch, 0, numSamples);
+    }
+
+    // library previews only ever go to the headphones
+    AudioSourceChannelInfo previewInfo{ &deckBuffer, 0, numSamples };
+    metadataService.getPreviewPlayer().getNextAudioBlock(previewInfo);
+    cueBus.addToCue(output, bufferToFill.startSample, deckBuffer, numSamples);
+
+    // the master bus is on the first two channels
+    masterMeter.process(output, bufferToFill.startSample, numSamples);
+    cueBus.measure(output, bufferToFill.startSample, numSamples);
+
+    // how much of the block's own duration the callback took. over 100% and the device will have run dry
+    double blockTicks = ticksPerSample.load() * numSamples;
+    if (blockTicks > 0.0)
+    {
+        float load = (float) ((double) (Time::getHighResolutionTicks() - callbackStart) / blockTicks);
+
+        if (load > 1.0f)
+        {
+            ++lateCallbacks;
+        }
+
+        if (load > worstLoad.load())
+        {
+            worstLoad.store(load);
+        }
+    }
 }
 
 void MainComponent::releaseResources()
 {
     // This will be called when the audio device stops, or when it is being
-    // restarted due to a setting change.
+    // restarted due to a setting change. The decks hold on to their decoded
+    // audio so nothing has to be read again when the device comes back.
 
     // For more details, see the help for AudioProcessor::releaseResources()
-    mixerSource.removeAllInputs();
-    mixerSource.releaseResources();
     player1.releaseResources();
     player2.releaseResources();
+    metadataService.getPreviewPlayer().releaseResources();
+    samplePads.releaseResources();
 }
 
 //==============================================================================
@@ -71,8 +325,25 @@ void MainComponent::paint (Graphics& g)
 
 void MainComponent::resized()
 {
-    deckGUI1.setBounds(0, 0, getWidth() / 2, (getHeight() / 3) * 2);
-    deckGUI2.setBounds(getWidth() / 2, 0, getWidth() / 2, (getHeight() / 3) * 2);
+    int meterW = 20;
+    int spectrumH = 40;
+    int deckW = (getWidth() - meterW * 2) / 2;
+    int deckH = (getHeight() / 3) * 2 - spectrumH;
+
+    deckGUI1.setBounds(0, 0, deckW, deckH);
+    deckGUI2.setBounds(deckW, 0, deckW, deckH);
+    masterLevels.setBounds(deckW * 2, 0, meterW, deckH);
+    cueMeter.setBounds(deckW * 2 + meterW, 0, meterW, deckH);
+    int midiW = 60;
+    int latencyW = 110;
+    masterSpectrum.setBounds(0, deckH, getWidth() / 4 - latencyW, spectrumH);
+    latencyLabel.setBounds(getWidth() / 4 - latencyW, deckH, latencyW, spectrumH);
+    crossfaderSlider.setBounds(getWidth() / 4, deckH, getWidth() / 2 - getWidth() / 4 - midiW * 2, spectrumH);
+    lowLatencyButton.setBounds(getWidth() / 2 - midiW * 2, deckH + 5, midiW - 5, spectrumH - 10);
+    midiButton.setBounds(getWidth() / 2 - midiW, deckH + 5, midiW - 5, spectrumH - 10);
+    autoDJ.setBounds(getWidth() / 2, deckH, getWidth() - getWidth() / 2, spectrumH);
 
-    playlistComponent.setBounds(0, (getHeight() / 3) * 2, getWidth(), (getHeight() / 3));
+    int padsW = 240;
+    playlistComponent.setBounds(0, (getHeight() / 3) * 2, getWidth() - padsW, (getHeight() / 3));
+    samplePadsComponent.setBounds(getWidth() - padsW, (getHeight() / 3) * 2, padsW, (getHeight() / 3));
 }
\ No newline at end of file
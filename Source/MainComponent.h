@@ -4,13 +4,20 @@
 #include "DJAudioPlayer.h"
 #include "DeckGUI.h"
 #include "PlaylistComponent.h"
+#include "CueBus.h"
+#include "TrackMetadataService.h"
+#include "AutoDJ.h"
+#include "SessionStore.h"
+#include "MidiController.h"
+#include "RealtimeCheck.h"
+#include "SamplePads.h"
 
 //==============================================================================
 /*
     This component lives inside our window, and this is where you should put all
     your controls and content.
 */
-class MainComponent   : public AudioAppComponent
+class MainComponent   : public AudioAppComponent, public Timer
 {
 public:
     //==============================================================================
@@ -26,25 +33,76 @@ public:
     void paint (Graphics& g) override;
     void resized() override;
 
+    /** keeps the crossfader slider in step with moves made from a controller, and the latency figures up to date */
+    void timerCallback() override;
+
 private:
     //==============================================================================
     // Your private member variables go here...
-    AudioFormatManager formatManager;
+    // one format registry and reader pool for the whole app
+    TrackMetadataService metadataService;
+    AudioFormatManager& formatManager{metadataService.getFormatManager()};
     AudioThumbnailCache thumbCache{100};
+    TrackAnalyser trackAnalyser{metadataService};
 
-    DJAudioPlayer player1{formatManager};
-    DJAudioPlayer player2{formatManager};
-    DJAudioPlayer playerForParsingMetaData{formatManager};
+    // both decks and the auto-DJ's crossfades run on one clock, moved on once per callback
+    SampleClock sampleClock;
+    DJAudioPlayer player1{formatManager, sampleClock};
+    DJAudioPlayer player2{formatManager, sampleClock};
 
-    DeckGUI deckGUI1{&player1, formatManager, thumbCache};
-    DeckGUI deckGUI2{&player2, formatManager, thumbCache};
+    DeckGUI deckGUI1{&player1, formatManager, thumbCache, trackAnalyser};
+    DeckGUI deckGUI2{&player2, formatManager, thumbCache, trackAnalyser};
 
     // https://docs.juce.com/master/classFileChooser.html#ac888983e4abdd8401ba7d6124ae64ff3
     juce::FileChooser fChooser{"Select a file..."};
 
-    MixerAudioSource mixerSource;
+    // decks are rendered once per callback into their own buffer, then summed into master and cue
+    AudioBuffer<float> deckBuffer;
+    CueBus cueBus;
+    CueMeter cueMeter{cueBus};
+
+    AudioMeter masterMeter;
+    MeterComponent masterLevels{masterMeter, MeterComponent::Style::levels};
+    MeterComponent masterSpectrum{masterMeter, MeterComponent::Style::spectrum};
+
+    AutoDJ autoDJ{&deckGUI1, &deckGUI2, &player1, &player2, sampleClock};
+
+    // 0 is all deck 1, 1 is all deck 2, both play at full level in the middle
+    SmoothedParameter crossfader{0.5, 0.05};
+    Slider crossfaderSlider;
+
+    // one-shots and loops, mixed into the master after the decks
+    SamplePads samplePads;
+    SamplePadsComponent samplePadsComponent{samplePads, formatManager};
+
+    MidiController midiController{player1, player2, crossfader, samplePads};
+    TextButton midiButton{"MIDI"};
+    Component::SafePointer<DialogWindow> midiWindow;
+
+    void showMidiMappings();
+
+    // low latency mode asks the device for a 64 sample buffer and keeps the whole callback free of locks
+    // and allocations, which debug builds check with RealtimeCheck
+    static constexpr int lowLatencyBufferSize = 64;
+    TextButton lowLatencyButton{"64"};
+    Label latencyLabel;
+    std::atomic<bool> lowLatency{false};
+    int normalBufferSize = 0;
+
+    void setLowLatency(bool shouldBeLowLatency);
+    void updateLatencyLabel();
+
+    // measured on the audio thread. a callback that takes longer than its own block is counted as late
+    std::atomic<double> ticksPerSample{0.0};
+    std::atomic<int> lateCallbacks{0};
+    std::atomic<float> worstLoad{0.0f};
+
+    PlaylistComponent playlistComponent{&deckGUI1, &deckGUI2, metadataService, trackAnalyser};
+
+    SessionStore sessionStore{SessionStore::getDefaultSessionFolder()};
 
-    PlaylistComponent playlistComponent{&deckGUI1, &deckGUI2, &playerForParsingMetaData};
+    /** puts back the library and decks from the last run, then saves every change from here on */
+    void restoreSession();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
@@ -0,0 +1,459 @@
+#include "MidiController.h"
+#include <cmath>
+
+namespace
+{
+    const int numDeckControls = MidiController::deck2Play - MidiController::deck1Play;
+
+    // one step of a relative jog wheel moves the track this far
+    const double jogSecondsPerStep = 0.01;
+
+    const char* deckControlNames[] = { "Play", "Stop", "Jog", "Pitch", "Volume", "Cue" };
+}
+
+//==============================================================================
+MidiController::MidiController(DJAudioPlayer& _player1, DJAudioPlayer& _player2, SmoothedParameter& _crossfader, SamplePads& _samplePads)
+    : players{ &_player1, &_player2 }, crossfaderPosition(_crossfader), samplePads(_samplePads)
+{
+    for (auto& mapping : mappings)
+    {
+        mapping.store(-1);
+    }
+}
+
+MidiController::~MidiController()
+{
+    for (auto& input : inputs)
+    {
+        input->stop();
+    }
+}
+
+String MidiController::getControlName(int control)
+{
+    if (control == crossfader)
+    {
+        return "Crossfader";
+    }
+
+    if (control >= pad1)
+    {
+        return "Pad " + String(control - pad1 + 1);
+    }
+
+    return "Deck " + String(control / numDeckControls + 1) + " " + deckControlNames[control % numDeckControls];
+}
+
+void MidiController::setInputEnabled(const MidiDeviceInfo& device, bool shouldBeEnabled)
+{
+    for (auto it = inputs.begin(); it != inputs.end(); ++it)
+    {
+        if ((*it)->getIdentifier() == device.identifier)
+        {
+            if (!shouldBeEnabled)
+            {
+                (*it)->stop();
+                inputs.erase(it);
+            }
+            return;
+        }
+    }
+
+    if (shouldBeEnabled)
+    {
+        // the input calls back on its own thread from here on
+        if (auto input = MidiInput::openDevice(device.identifier, this))
+        {
+            input->start();
+            inputs.push_back(std::move(input));
+        }
+    }
+}
+
+bool MidiController::isInputEnabled(const String& identifier) const
+{
+    for (auto& input : inputs)
+    {
+        if (input->getIdentifier() == identifier)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MidiController::startLearning(int control)
+{
+    learningControl.store(control);
+}
+
+int MidiController::getLearningControl() const
+{
+    return learningControl.load();
+}
+
+int MidiController::getMessageKey(const MidiMessage& message)
+{
+    int channel = message.getChannel() - 1;
+
+    if (message.isController())
+    {
+        return channel * 128 + message.getControllerNumber();
+    }
+
+    if (message.isNoteOnOrOff())
+    {
+        return 16 * 128 + channel * 128 + message.getNoteNumber();
+    }
+
+    return -1;
+}
+
+void MidiController::setMapping(int key, int control)
+{
+    // a control has one binding, so learning it again moves it
+    clearMapping(control);
+    mappings[(size_t) key].store(control);
+}
+
+void MidiController::clearMapping(int control)
+{
+    for (auto& mapping : mappings)
+    {
+        int expected = control;
+        mapping.compare_exchange_strong(expected, -1);
+    }
+}
+
+String MidiController::getMappingName(int control) const
+{
+    for (int key = 0; key < numKeys; ++key)
+    {
+        if (mappings[(size_t) key].load() == control)
+        {
+            String type = key >= 16 * 128 ? "Note " : "CC ";
+            return type + String(key % 128) + ", ch " + String((key / 128) % 16 + 1);
+        }
+    }
+
+    return "-";
+}
+
+void MidiController::handleIncomingMidiMessage(MidiInput*, const MidiMessage& message)
+{
+    handleMessage(message);
+}
+
+void MidiController::handleMessage(const MidiMessage& message)
+{
+    int key = getMessageKey(message);
+    if (key < 0)
+    {
+        return;
+    }
+
+    // an armed control takes the next press or move, which is not acted on
+    int learning = learningControl.load();
+    if (learning >= 0)
+    {
+        if (!message.isNoteOff() && learningControl.compare_exchange_strong(learning, -1))
+        {
+            setMapping(key, learning);
+        }
+        return;
+    }
+
+    int control = mappings[(size_t) key].load();
+    if (control < 0)
+    {
+        return;
+    }
+
+    int value = message.isController() ? message.getControllerValue() : (message.isNoteOn() ? (int) message.getVelocity() : 0);
+
+    // jog wheels send relative steps, 1 to 63 forwards and 65 to 127 backwards
+    if (control < crossfader && control % numDeckControls == deck1Jog)
+    {
+        value = value < 64 ? value : value - 128;
+    }
+
+    const SpinLock::ScopedLockType sl(writerLock);
+
+    // with the fifo full the event is dropped. the next move of the same control supersedes it anyway
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        events[(size_t) start1] = { control, value, message.isNoteOnOrOff() };
+        fifo.finishedWrite(1);
+    }
+}
+
+void MidiController::processPendingEvents()
+{
+    int numReady = fifo.getNumReady();
+    if (numReady == 0)
+    {
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+    {
+        applyEvent(events[(size_t) (start1 + i)]);
+    }
+
+    for (int i = 0; i < size2; ++i)
+    {
+        applyEvent(events[(size_t) (start2 + i)]);
+    }
+
+    fifo.finishedRead(size1 + size2);
+
+    lastAppliedTicks.store(Time::getHighResolutionTicks());
+    numApplied.fetch_add(size1 + size2);
+}
+
+void MidiController::applyEvent(const ControlEvent& event)
+{
+    if (event.control == crossfader)
+    {
+        crossfaderPosition.setTarget(event.value / 127.0);
+        return;
+    }
+
+    // pads play on the press at its velocity, the release is ignored. they start with the block, like everything else here
+    if (event.control >= pad1)
+    {
+        if (event.value > 0)
+        {
+            samplePads.triggerNow(event.control - pad1, event.value / 127.0f);
+        }
+        return;
+    }
+
+    auto* player = players[event.control / numDeckControls];
+
+    // a note is pressed at any velocity, so a soft hit on a velocity sensitive pad still counts. a CC button
+    // sends 127 and 0, anything in between is a fader or knob crossing the middle
+    bool pressed = event.isNote ? event.value > 0 : event.value >= 64;
+
+    switch (event.control % numDeckControls)
+    {
+        case deck1Play:
+            if (pressed)
+            {
+                player->requestStart();
+            }
+            break;
+
+        case deck1Stop:
+            if (pressed)
+            {
+                player->requestStop();
+            }
+            break;
+
+        case deck1Jog:
+            // in vinyl mode the jog wheel scratches, otherwise it nudges the track along
+            if (player->isVinylMode())
+            {
+                player->scrub(event.value * jogSecondsPerStep);
+            }
+            else
+            {
+                player->nudge(event.value * jogSecondsPerStep);
+            }
+            break;
+
+        case deck1Pitch:
+            // centred on normal speed, from half to double
+            player->setSpeed(std::pow(2.0, (event.value / 127.0 - 0.5) * 2.0));
+            break;
+
+        case deck1Volume:
+            player->setGain(event.value / 127.0);
+            break;
+
+        case deck1Cue:
+            if (pressed)
+            {
+                player->setCued(!player->isCued());
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+int MidiController::getNumApplied() const
+{
+    return numApplied.load();
+}
+
+int64 MidiController::getLastAppliedTicks() const
+{
+    return lastAppliedTicks.load();
+}
+
+ValueTree MidiController::getState() const
+{
+    ValueTree state{ "MIDI" };
+
+    for (int key = 0; key < numKeys; ++key)
+    {
+        int control = mappings[(size_t) key].load();
+
+        if (control >= 0)
+        {
+            state.appendChild(ValueTree{ "MAPPING", { { "key", key }, { "control", control } } }, nullptr);
+        }
+    }
+
+    for (auto& input : inputs)
+    {
+        state.appendChild(ValueTree{ "INPUT", { { "identifier", input->getIdentifier() } } }, nullptr);
+    }
+
+    return state;
+}
+
+void MidiController::restoreState(const ValueTree& state)
+{
+    if (!state.hasType("MIDI"))
+    {
+        return;
+    }
+
+    auto available = MidiInput::getAvailableDevices();
+
+    for (const auto& child : state)
+    {
+        if (child.hasType("MAPPING"))
+        {
+            int key = child["key"];
+            int control = child["control"];
+
+            if (key >= 0 && key < numKeys && control >= 0 && control < numControls)
+            {
+                mappings[(size_t) key].store(control);
+            }
+        }
+        else if (child.hasType("INPUT"))
+        {
+            // controllers that are not plugged in this time are skipped
+            for (auto& device : available)
+            {
+                if (device.identifier == child["identifier"].toString())
+                {
+                    setInputEnabled(device, true);
+                }
+            }
+        }
+    }
+}
+
+//==============================================================================
+MidiMappingPanel::MidiMappingPanel(MidiController& _controller) : controller(_controller)
+{
+    devices = MidiInput::getAvailableDevices();
+
+    for (auto& device : devices)
+    {
+        auto* button = inputButtons.add(new ToggleButton(device.name));
+        button->setToggleState(controller.isInputEnabled(device.identifier), dontSendNotification);
+        button->onClick = [this, button, device]
+        {
+            controller.setInputEnabled(device, button->getToggleState());
+            changed();
+        };
+        addAndMakeVisible(button);
+    }
+
+    for (int control = 0; control < MidiController::numControls; ++control)
+    {
+        auto* nameLabel = controlLabels.add(new Label({}, MidiController::getControlName(control)));
+        auto* mappingLabel = mappingLabels.add(new Label({}, controller.getMappingName(control)));
+        auto* learnButton = learnButtons.add(new TextButton("Learn"));
+        auto* clearButton = clearButtons.add(new TextButton("Clear"));
+
+        learnButton->onClick = [this, control] {controller.startLearning(control);};
+        clearButton->onClick = [this, control]
+        {
+            controller.clearMapping(control);
+            changed();
+        };
+
+        addAndMakeVisible(nameLabel);
+        addAndMakeVisible(mappingLabel);
+        addAndMakeVisible(learnButton);
+        addAndMakeVisible(clearButton);
+    }
+
+    setSize(420, (devices.size() + MidiController::numControls) * 24 + 10);
+    startTimer(100);
+}
+
+MidiMappingPanel::~MidiMappingPanel()
+{
+    stopTimer();
+}
+
+void MidiMappingPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+}
+
+void MidiMappingPanel::resized()
+{
+    int rowH = 24;
+    int y = 5;
+
+    for (auto* button : inputButtons)
+    {
+        button->setBounds(5, y, getWidth() - 10, rowH);
+        y += rowH;
+    }
+
+    int colW = (getWidth() - 10) / 5;
+
+    for (int control = 0; control < MidiController::numControls; ++control)
+    {
+        controlLabels[control]->setBounds(5, y, colW * 2, rowH);
+        mappingLabels[control]->setBounds(5 + colW * 2, y, colW, rowH);
+        learnButtons[control]->setBounds(5 + colW * 3, y + 2, colW - 4, rowH - 4);
+        clearButtons[control]->setBounds(5 + colW * 4, y + 2, colW - 4, rowH - 4);
+        y += rowH;
+    }
+}
+
+void MidiMappingPanel::timerCallback()
+{
+    // learning finishes on a MIDI thread, so the panel looks for it here
+    int learning = controller.getLearningControl();
+
+    for (int control = 0; control < MidiController::numControls; ++control)
+    {
+        mappingLabels[control]->setText(control == learning ? "Move a control..." : controller.getMappingName(control), dontSendNotification);
+    }
+
+    if (wasLearning >= 0 && learning < 0)
+    {
+        changed();
+    }
+
+    wasLearning = learning;
+}
+
+void MidiMappingPanel::changed()
+{
+    if (onChange != nullptr)
+    {
+        onChange();
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DJAudioPlayer.h"
+#include "DeckParameters.h"
+#include "SamplePads.h"
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/*
+    Drives the decks from MIDI controllers. Messages arrive on each input's own
+    MIDI thread, are looked up in the mapping table there and pushed into a
+    lock-free fifo. The audio thread drains the fifo at the start of every
+    block, so a fader move reaches the decks without going near the message
+    thread. Any control can be learnt by moving it while the control is armed.
+*/
+class MidiController : private MidiInputCallback
+{
+public:
+    enum Control
+    {
+        deck1Play, deck1Stop, deck1Jog, deck1Pitch, deck1Volume, deck1Cue,
+        deck2Play, deck2Stop, deck2Jog, deck2Pitch, deck2Volume, deck2Cue,
+        crossfader,
+        pad1, pad2, pad3, pad4, pad5, pad6, pad7, pad8,
+        numControls
+    };
+
+    MidiController(DJAudioPlayer& _player1, DJAudioPlayer& _player2, SmoothedParameter& _crossfader, SamplePads& _samplePads);
+    ~MidiController() override;
+
+    static String getControlName(int control);
+
+    /** opens or closes an input. message thread */
+    void setInputEnabled(const MidiDeviceInfo& device, bool shouldBeEnabled);
+    bool isInputEnabled(const String& identifier) const;
+
+    /** arms a control, the next note or CC that arrives is bound to it */
+    void startLearning(int control);
+    int getLearningControl() const;
+
+    /** table key for a note or CC message, -1 for anything that cannot be mapped */
+    static int getMessageKey(const MidiMessage& message);
+    void setMapping(int key, int control);
+    void clearMapping(int control);
+    String getMappingName(int control) const;
+
+    /** feeds a message in as if it came from an input. safe from any thread */
+    void handleMessage(const MidiMessage& message);
+
+    /** audio thread: applies everything received since the last block. call before the decks render */
+    void processPendingEvents();
+
+    /** how many events the audio thread has applied, and when it last did, in high resolution ticks */
+    int getNumApplied() const;
+    int64 getLastAppliedTicks() const;
+
+    /** mappings and open inputs, for the session */
+    ValueTree getState() const;
+    void restoreState(const ValueTree& state);
+
+private:
+    struct ControlEvent
+    {
+        int control;
+        int value;  // 0 to 127, or a signed step for jog
+        bool isNote; // a note's value is its velocity, 0 for note off
+    };
+
+    void handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) override;
+    void applyEvent(const ControlEvent& event);
+
+    // channel, note or CC, and number
+    static constexpr int numKeys = 2 * 16 * 128;
+    static constexpr int fifoSize = 256;
+
+    DJAudioPlayer* players[2];
+    SmoothedParameter& crossfaderPosition;
+    SamplePads& samplePads;
+
+    std::array<std::atomic<int>, numKeys> mappings;
+    std::atomic<int> learningControl{ -1 };
+
+    // each input has its own thread, they take turns to write. the audio thread reads the fifo without locking,
+    // but a start or stop it applies still goes through a deck's transport, which locks and posts a change message
+    SpinLock writerLock;
+    AbstractFifo fifo{ fifoSize };
+    std::array<ControlEvent, fifoSize> events;
+
+    std::atomic<int> numApplied{ 0 };
+    std::atomic<int64> lastAppliedTicks{ 0 };
+
+    std::vector<std::unique_ptr<MidiInput>> inputs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiController)
+};
+
+//==============================================================================
+/*
+    Lists the MIDI inputs and every mappable control, with a Learn button for
+    each. Shown in its own window from the MIDI button.
+*/
+class MidiMappingPanel : public juce::Component, public Timer
+{
+public:
+    MidiMappingPanel(MidiController& _controller);
+    ~MidiMappingPanel() override;
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+    void timerCallback() override;
+
+    /** called whenever a mapping or input changes */
+    std::function<void()> onChange;
+
+private:
+    void changed();
+
+    MidiController& controller;
+
+    Array<MidiDeviceInfo> devices;
+    OwnedArray<ToggleButton> inputButtons;
+    OwnedArray<Label> controlLabels;
+    OwnedArray<Label> mappingLabels;
+    OwnedArray<TextButton> learnButtons;
+    OwnedArray<TextButton> clearButtons;
+
+    int wasLearning = -1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiMappingPanel)
+};
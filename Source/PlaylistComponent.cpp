@@ -3,9 +3,67 @@
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <map>
+#include <numeric>
+#include <limits>
+
+// true when the folder already holds the same track as source, whatever it is called there, so copying it again can be skipped
+static bool isAlreadySynced(const File& source, const std::multimap<int64, File>& folderFilesBySize)
+{
+    // only files of the same size are hashed
+    auto sameSize = folderFilesBySize.equal_range(source.getSize());
+
+    for (auto it = sameSize.first; it != sameSize.second; ++it)
+    {
+        if (it->second == source || MD5(it->second) == MD5(source))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// m:ss, or - when the length is unknown
+static String formatDuration(double lengthInSeconds)
+{
+    if (lengthInSeconds < 0.0)
+    {
+        return "-";
+    }
+
+    int roundedSecs = roundToInt(lengthInSeconds);
+    return String(roundedSecs / 60) + ":" + String(roundedSecs % 60).paddedLeft('0', 2);
+}
+
+// accepts m:ss or plain seconds, negative if the text is neither
+static double parseDuration(const String& text)
+{
+    if (text.containsChar(':'))
+    {
+        return text.upToFirstOccurrenceOf(":", false, false).getIntValue() * 60.0 + text.fromFirstOccurrenceOf(":", false, false).getDoubleValue();
+    }
+
+    return text.containsOnly("0123456789.") && text.isNotEmpty() ? text.getDoubleValue() : -1.0;
+}
+
+//==============================================================================
+RowActionButton::RowActionButton(const String& buttonName) : TextButton(buttonName)
+{
+}
+
+void RowActionButton::setRow(int newRow)
+{
+    row = newRow;
+}
+
+int RowActionButton::getRow() const
+{
+    return row;
+}
 
 //==============================================================================
-PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, DJAudioPlayer* _playerForParsingMetaData) : deckGUI1(_deckGUI1), deckGUI2(_deckGUI2), playerForParsingMetaData(_playerForParsingMetaData)
+PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, TrackMetadataService& _metadataService, TrackAnalyser& _trackAnalyser) : deckGUI1(_deckGUI1), deckGUI2(_deckGUI2), metadataService(_metadataService), trackAnalyser(_trackAnalyser)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
@@ -13,12 +71,17 @@ PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, DJA
     // create a new directory to store the tracks
     musicFolder.createDirectory();
 
-    // adding different columns into the table component
+    // adding different columns into the table component. only the value columns can be sorted on
+    int buttonColumnFlags = TableHeaderComponent::defaultFlags & ~TableHeaderComponent::sortable;
+
     tableComponent.getHeader().addColumn("Track Title", 1, 50);
     tableComponent.getHeader().addColumn("Duration", 2, 50);
-    tableComponent.getHeader().addColumn("Load to Deck 1", 3, 50);
-    tableComponent.getHeader().addColumn("Load to Deck 2", 4, 50);
-    tableComponent.getHeader().addColumn("Delete", 5, 50);
+    tableComponent.getHeader().addColumn("Key", 8, 50);
+    tableComponent.getHeader().addColumn("Added", 9, 50);
+    tableComponent.getHeader().addColumn("Load to Deck 1", 3, 50, 30, -1, buttonColumnFlags);
+    tableComponent.getHeader().addColumn("Load to Deck 2", 4, 50, 30, -1, buttonColumnFlags);
+    tableComponent.getHeader().addColumn("Delete", 5, 50, 30, -1, buttonColumnFlags);
+    tableComponent.getHeader().addColumn("Auto DJ", 6, 50, 30, -1, buttonColumnFlags);
 
     tableComponent.setModel(this);
 
@@ -27,21 +90,29 @@ PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, DJA
     addAndMakeVisible(libLoadBtn);
     addAndMakeVisible(libSaveBtn);
     addAndMakeVisible(libRestoreBtn);
+    addAndMakeVisible(libWatchBtn);
+    addAndMakeVisible(libSuggestBtn);
     addAndMakeVisible(trackFinder);
 
     // adding listeners
     libLoadBtn.addListener(this);
     libSaveBtn.addListener(this);
     libRestoreBtn.addListener(this);
+    libWatchBtn.addListener(this);
+    libSuggestBtn.addListener(this);
+
+    // when on, only tracks that mix with a loaded deck are shown
+    libSuggestBtn.setClickingTogglesState(true);
+
+    // changes in watched folders are applied to the library one file at a time
+    folderWatcher.onFileChanged = [this](const File& file, FolderWatcher::FileChange change) {applyFolderChange(file, change);};
 
     // track finder configs
-    trackFinder.setTextToShowWhenEmpty("Find track", Colours::white);
+    trackFinder.setTextToShowWhenEmpty("Find track, or filter with dur:3:00-6:00 key:8A-9A added:0-7", Colours::white);
     trackFinder.setJustification(Justification::centred);
 
     // calls a lambda function whenever the return key is pressed. lambda function takes on user search input to find track in library
     trackFinder.onReturnKey = [this] {findTrack(trackFinder.getText());};
-
-    formatManager.registerBasicFormats();
 }
 
 PlaylistComponent::~PlaylistComponent()
@@ -64,28 +135,34 @@ void PlaylistComponent::paint (juce::Graphics& g)
 void PlaylistComponent::resized()
 {
     double rowH = getHeight() / 8;
-    double rowW = getWidth() / 5;
+    double rowW = getWidth() / 10;
 
-    // setting column bounds
+    // setting column bounds, the title gets two shares of the width
     tableComponent.setBounds(0, rowH, getWidth(), getHeight());
-    tableComponent.getHeader().setColumnWidth(1, rowW);
-    tableComponent.getHeader().setColumnWidth(2, rowW);
-    tableComponent.getHeader().setColumnWidth(3, rowW);
-    tableComponent.getHeader().setColumnWidth(4, rowW);
-    tableComponent.getHeader().setColumnWidth(5, rowW);
+    tableComponent.getHeader().setColumnWidth(1, rowW * 2);
+
+    auto& header = tableComponent.getHeader();
+
+    for (int i = 1; i < header.getNumColumns(false); ++i)
+    {
+        header.setColumnWidth(header.getColumnIdOfIndex(i, false), rowW);
+    }
 
     // setting button bounds
-    libLoadBtn.setBounds(getWidth() / 4, 0, getWidth() / 4, rowH);
-    libSaveBtn.setBounds((getWidth() / 4) * 3, 0, getWidth() / 4, rowH);
-    libRestoreBtn.setBounds(getWidth() / 2, 0, getWidth() / 4, rowH);
+    libLoadBtn.setBounds(getWidth() / 6, 0, getWidth() / 6, rowH);
+    libRestoreBtn.setBounds((getWidth() / 6) * 2, 0, getWidth() / 6, rowH);
+    libSaveBtn.setBounds((getWidth() / 6) * 3, 0, getWidth() / 6, rowH);
+    libWatchBtn.setBounds((getWidth() / 6) * 4, 0, getWidth() / 6, rowH);
+    libSuggestBtn.setBounds((getWidth() / 6) * 5, 0, getWidth() / 6, rowH);
 
     // setting track finder bounds
-    trackFinder.setBounds(0, 0, getWidth() / 4, rowH);
+    trackFinder.setBounds(0, 0, getWidth() / 6, rowH);
 }
 
 int PlaylistComponent::getNumRows()
 {
-    return trackTitles.size();
+    updateView();
+    return (int) view.size();
 }
 
 // logic to show selected row. when row is selected, its colour is changed to show highlight
@@ -98,74 +175,89 @@ void PlaylistComponent::paintRowBackground(Graphics& g, int rowNumber, int width
     else {
         g.fillAll(Colours::darkgrey);
     }
+
+    // tracks in a key that mixes with a loaded deck get a stripe, blue for deck 1, green for deck 2
+    int index = getTrackForRow(rowNumber);
+    uint8 suggestedFor = index >= 0 ? tracks[(size_t) index].suggestedFor : 0;
+
+    if (suggestedFor != 0 && !rowIsSelected)
+    {
+        g.setColour(suggestedFor == 1 ? Colours::steelblue : (suggestedFor == 2 ? Colours::seagreen : Colours::cadetblue));
+        g.fillRect(0, 0, 4, height);
+    }
 }
 
 // generates different columns
 void PlaylistComponent::paintCell(Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected)
 {
+    // the table can still ask for a row that has just been deleted
+    int index = getTrackForRow(rowNumber);
+    if (index < 0)
+    {
+        return;
+    }
+
+    auto& track = tracks[index];
+
     // track title column
     if (columnId == 1)
     {
-        g.drawText(trackTitles[rowNumber], 5, 0, width, height, Justification::centredLeft, true);
+        String title = track.title;
+
+        if (!track.mergedFiles.isEmpty())
+        {
+            title << " (" << (track.mergedFiles.size() + 1) << " copies)";
+        }
+
+        // possible duplicates are picked out until they are merged or dismissed
+        if (track.nearDuplicateOf != File())
+        {
+            title << " (sounds like " << track.nearDuplicateOf.getFileName() << ")";
+            g.setColour(Colours::yellow);
+        }
+
+        g.drawText(title, 5, 0, width, height, Justification::centredLeft, true);
     }
 
     // track duration column
     if (columnId == 2)
     {
-        g.drawText(trackDurations[rowNumber], 5, 0, width, height, Justification::centredLeft, true);
+        g.drawText(track.duration, 5, 0, width, height, Justification::centredLeft, true);
     }
-}
 
-Component* PlaylistComponent::refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected, Component* existingComponentToUpdate)
-{
-    // each column generates its own respective buttons. buttons are then asigned an ID to differentiate them from each other.
-    // buttons contains lamdba function which loads track onto the corresponding decks or to delete track from library
-    // load to deck1 column
-    if (columnId == 3)
+    if (columnId == 8)
     {
-        if (existingComponentToUpdate == nullptr)
-        {
-            TextButton* loadBtn1 = new TextButton{ "Load" };
-            String id{ std::to_string(rowNumber) };
-            loadBtn1->setComponentID(id);
-            loadBtn1->addListener(this);
-            existingComponentToUpdate = loadBtn1;
-
-            loadBtn1->onClick = [this] {loadIntoDeck1();};
-        }
+        g.drawText(HarmonicIndex::getKeyName(track.camelotKey), 5, 0, width, height, Justification::centredLeft, true);
     }
 
-    // load to deck 2 colum
-    if (columnId == 4)
+    if (columnId == 9)
     {
-        if (existingComponentToUpdate == nullptr)
-        {
-            TextButton* loadBtn2 = new TextButton{ "Load" };
-            String id{ std::to_string(rowNumber) };
-            loadBtn2->setComponentID(id);
-            loadBtn2->addListener(this);
-            existingComponentToUpdate = loadBtn2;
+        g.drawText(Time(track.dateAdded).toString(true, false), 5, 0, width, height, Justification::centredLeft, true);
+    }
+}
 
-            loadBtn2->onClick = [this] {loadIntoDeck2();};
-        }
+Component* PlaylistComponent::refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected, Component* existingComponentToUpdate)
+{
+    // columns 3-6 hold the load to deck 1, load to deck 2, delete and queue buttons. the table only asks for
+    // components on visible rows, so a button is created once per on-screen cell and then recycled
+    if (columnId < 3 || columnId > 6 || getTrackForRow(rowNumber) < 0)
+    {
+        delete existingComponentToUpdate;
+        return nullptr;
     }
 
-    // delete track
-    if (columnId == 5)
+    auto* button = static_cast<RowActionButton*>(existingComponentToUpdate);
+
+    if (button == nullptr)
     {
-        if (existingComponentToUpdate == nullptr)
-        {
-            TextButton* delBtn = new TextButton { "Delete" };
-            String id{ std::to_string(rowNumber) };
-            delBtn->setComponentID(id);
-            delBtn->addListener(this);
-            existingComponentToUpdate = delBtn;
+        button = new RowActionButton{ columnId == 5 ? "Delete" : (columnId == 6 ? "Queue" : "Load") };
 
-            delBtn->onClick = [this] {deleteTrack();};
-        }
+        // bound once. the button reads its current row when clicked, so recycling it is just an int store
+        button->onClick = [this, button, columnId] {handleRowAction(columnId, button->getRow());};
     }
 
-    return existingComponentToUpdate;
+    button->setRow(rowNumber);
+    return button;
 }
 
 // logic to handle button events
@@ -196,157 +288,1231 @@ void PlaylistComponent::buttonClicked(Button* button)
         tableComponent.updateContent();
     }
 
-    rowSelected = button->getComponentID().getDoubleValue();
+    if (button == &libWatchBtn)
+    {
+        // picking a folder to keep the library in sync with
+        watchFolder();
+
+        tableComponent.updateContent();
+    }
+
+    if (button == &libSuggestBtn)
+    {
+        // showing or hiding everything that is not a suggestion
+        invalidateView(false);
+        tableComponent.updateContent();
+        tableComponent.repaint();
+    }
+}
+
+void PlaylistComponent::cellDoubleClicked(int rowNumber, int columnId, const MouseEvent&)
+{
+    int index = getTrackForRow(rowNumber);
+    if (index >= 0)
+    {
+        metadataService.togglePreview(tracks[index].file);
+    }
+}
+
+void PlaylistComponent::cellClicked(int rowNumber, int columnId, const MouseEvent& event)
+{
+    int index = getTrackForRow(rowNumber);
+    if (!event.mods.isPopupMenu() || index < 0 || tracks[index].nearDuplicateOf == File())
+    {
+        return;
+    }
+
+    File file = tracks[index].file;
+    File similar = tracks[index].nearDuplicateOf;
+
+    PopupMenu menu;
+    menu.addItem(1, "Merge into " + similar.getFileName());
+    menu.addItem(2, "Not a duplicate");
+
+    Component::SafePointer<PlaylistComponent> safeThis(this);
+
+    menu.showMenuAsync(PopupMenu::Options(), [safeThis, file, similar](int result)
+    {
+        // rows can move while the menu is open, so both tracks are looked up again
+        if (safeThis == nullptr || result == 0)
+        {
+            return;
+        }
+
+        int row = safeThis->findRow(file);
+        int similarRow = safeThis->findRow(similar);
+
+        if (row < 0)
+        {
+            return;
+        }
+
+        if (result == 1 && similarRow >= 0)
+        {
+            safeThis->mergeTracks(row, similarRow);
+        }
+        else
+        {
+            safeThis->tracks[row].nearDuplicateOf = File();
+            safeThis->tracks[row].dismissedDuplicates.addIfNotAlreadyThere(similar);
+            safeThis->duplicateIndex.dismiss(file, similar);
+            safeThis->tableComponent.repaint();
+            safeThis->libraryChanged();
+        }
+    });
+}
+
+void PlaylistComponent::handleRowAction(int columnId, int rowNumber)
+{
+    // the button knows its table row, the track behind it depends on the sort and filters
+    int row = getTrackForRow(rowNumber);
+    if (row < 0)
+    {
+        return;
+    }
+
+    if (columnId == 3)
+    {
+        loadIntoDeck1(row);
+    }
+
+    if (columnId == 4)
+    {
+        loadIntoDeck2(row);
+    }
+
+    if (columnId == 5)
+    {
+        deleteTrack(row);
+    }
+
+    if (columnId == 6 && onQueueTrack != nullptr)
+    {
+        onQueueTrack(tracks[row].file);
+    }
 }
 
-void PlaylistComponent::loadIntoDeck1()
+void PlaylistComponent::loadIntoDeck1(int row)
 {
     // load track file to deck1
-    deckGUI1->loadFile(addedTracks[rowSelected]);
+    deckGUI1->loadFile(tracks[row].url);
 }
 
-void PlaylistComponent::loadIntoDeck2()
+void PlaylistComponent::loadIntoDeck2(int row)
 {
     // load track file to deck2
-    deckGUI2->loadFile(addedTracks[rowSelected]);
+    deckGUI2->loadFile(tracks[row].url);
 }
 
-void PlaylistComponent::deleteTrack()
+void PlaylistComponent::deleteTrack(int row)
 {
-    // Delete selected track from music lib. track meta data is also removed from other respective arrays
-    trackDurations.erase(trackDurations.begin() + rowSelected);
-    trackTitles.erase(trackTitles.begin() + rowSelected);
-    addedTracks.remove(rowSelected);
-    addedFiles.remove(rowSelected);
+    // Delete selected track from music lib along with all its meta data
+    File file = tracks[(size_t) row].file;
+
+    duplicateIndex.remove(file);
+    harmonicIndex.remove(file);
+    rowByPath.erase(file.getFullPathName());
+    tracks.erase(tracks.begin() + row);
 
+    // rows after it move up one, and nothing is flagged as a copy of it any more
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (i >= (size_t) row)
+        {
+            rowByPath[tracks[i].file.getFullPathName()] = i;
+        }
+
+        if (tracks[i].nearDuplicateOf == file)
+        {
+            tracks[i].nearDuplicateOf = File();
+        }
+    }
+
+    invalidateView(true);
     tableComponent.updateContent();
+    libraryChanged();
 }
 
-// logic to handle search result
-void PlaylistComponent::findTrack(String searchText)
+void PlaylistComponent::sortOrderChanged(int newSortColumnId, bool isForwards)
 {
-    // if there is a match, the row is highlighted by change of colour
-    if (searchText != "")
+    // the clicked column becomes the primary key and the previous ones break ties
+    for (int i = sortKeys.size(); --i >= 0;)
     {
-        getTrackIndex(searchText);
+        if (sortKeys[i].columnId == newSortColumnId)
+        {
+            sortKeys.remove(i);
+        }
+    }
 
-        int rowNumber = getTrackIndex(searchText);
-        tableComponent.selectRow(rowNumber);
+    if (newSortColumnId > 0)
+    {
+        sortKeys.insert(0, { newSortColumnId, isForwards });
     }
     else
     {
-        tableComponent.deselectAllRows();
+        sortKeys.clear();
+    }
+
+    while (sortKeys.size() > maxSortKeys)
+    {
+        sortKeys.removeLast();
     }
+
+    invalidateView(false);
+    tableComponent.updateContent();
+    tableComponent.repaint();
 }
 
-// function to search library
-int PlaylistComponent::getTrackIndex(String searchText)
+void PlaylistComponent::invalidateView(bool tracksChanged)
 {
-    // searches the track title array for a match, then returns the index
-    auto index = find_if(trackTitles.begin(), trackTitles.end(), [&searchText](const String& string) {return string.contains(searchText); });
-    int i = -1;
+    if (tracksChanged)
+    {
+        keyColumns.clear();
+        sortCache.clear();
+    }
+
+    viewDirty = true;
+}
+
+// function to take one track's new value in a single column, dropping only the sort orders that use it.
+// the title column is ranked across all tracks, so a title change goes through invalidateView instead
+void PlaylistComponent::invalidateColumn(int columnId, int index)
+{
+    jassert(columnId != 1);
 
-    if (index != trackTitles.end())
+    auto keys = keyColumns.find(columnId);
+    if (keys != keyColumns.end() && keys->second.size() == tracks.size())
     {
-        i = std::distance(trackTitles.begin(), index);
+        keys->second[(size_t) index] = getKeyValue(columnId, (size_t) index);
     }
 
-    return i;
+    for (auto it = sortCache.begin(); it != sortCache.end(); )
+    {
+        if (StringArray::fromTokens(it->first, "+-", "").contains(String(columnId)))
+        {
+            it = sortCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    viewDirty = true;
 }
 
-// function to load track to library
-void PlaylistComponent::loadToLib()
+// function to rebuild the visible rows from the sort order, dropping anything outside the filters
+void PlaylistComponent::updateView()
 {
-    // user selects file
-    std::string trackTitle;
-    FileChooser chooser{ "Add files to library" };
+    if (!viewDirty)
+    {
+        return;
+    }
 
-    if (chooser.browseForMultipleFilesToOpen())
+    const auto& order = getSortOrder();
+
+    bool suggestionsOnly = libSuggestBtn.getToggleState();
+
+    if (filters.isEmpty() && !suggestionsOnly)
     {
-        for (File& selectedFiles : chooser.getResults())
+        view = order;
+    }
+    else
+    {
+        std::vector<const std::vector<double>*> filterKeys;
+        for (auto& filter : filters)
+        {
+            filterKeys.push_back(&getKeyColumn(filter.columnId));
+        }
+
+        view.clear();
+        view.reserve(order.size());
+
+        for (int index : order)
         {
-            // Retrieve track title and converts it into a string
-            // string is then pushed into trackTitles array
-            trackTitle = selectedFiles.getFileName().toStdString();
-            trackTitles.push_back(trackTitle);
+            bool keep = !suggestionsOnly || tracks[(size_t) index].suggestedFor != 0;
 
-            // Track file is added to the addedFiles array
-            addedFiles.add(selectedFiles);
-            
-            // Track file is added to addedTrack array
-            addedTracks.add(URL{ selectedFiles });
+            for (int i = 0; i < filters.size() && keep; ++i)
+            {
+                double value = (*filterKeys[(size_t) i])[(size_t) index];
+                keep = value >= filters[i].minimum && value <= filters[i].maximum;
+            }
 
-            // Retrieve track duration and is processesed before pushing to array
-            std::string duration = getTrackDur(selectedFiles).toStdString();
-            trackDurations.push_back(duration);
+            if (keep)
+            {
+                view.push_back(index);
+            }
         }
     }
+
+    viewDirty = false;
 }
 
-// function to save track to library
-void PlaylistComponent::saveLib()
+int PlaylistComponent::getTrackForRow(int row)
+{
+    updateView();
+    return row >= 0 && row < (int) view.size() ? view[(size_t) row] : -1;
+}
+
+// function to get the sort key of every track for a column, built once per library change
+const std::vector<double>& PlaylistComponent::getKeyColumn(int columnId)
 {
-    for (int i = 0; i < addedFiles.size(); i++)
+    auto& keys = keyColumns[columnId];
+    if (keys.size() == tracks.size())
+    {
+        return keys;
+    }
+
+    keys.resize(tracks.size());
+
+    if (columnId == 1)
     {
-        // files are added to folder
-        File folder(musicFolder.getFullPathName() + "/" + addedFiles[i].getFileName());
+        // titles are ranked once, so sorting and tie-breaking on them afterwards only compares numbers
+        std::vector<int> byTitle(tracks.size());
+        std::iota(byTitle.begin(), byTitle.end(), 0);
+        std::sort(byTitle.begin(), byTitle.end(), [this](int a, int b) {return tracks[(size_t) a].title.compareNatural(tracks[(size_t) b].title) < 0; });
 
-        if (addedFiles[i].copyFileTo(folder))
+        for (size_t rank = 0; rank < byTitle.size(); ++rank)
         {
-            DBG("Track copied");
-        }
-        else {
-            DBG("Track not copied");
+            keys[(size_t) byTitle[rank]] = (double) rank;
         }
+
+        return keys;
+    }
+
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        keys[i] = getKeyValue(columnId, i);
     }
+
+    return keys;
 }
 
-// function to load from file to library
-void PlaylistComponent::loadLib()
+// function to get the sort key of one track for any column but the title
+double PlaylistComponent::getKeyValue(int columnId, size_t index) const
 {
-    int numOfTracks;
+    auto& track = tracks[index];
 
-    if (musicFolder.isDirectory())
+    // unknown values stay negative, so they sort before everything else
+    switch (columnId)
+    {
+        case 2: return track.lengthInSeconds;
+        case 8: return (double) track.camelotKey;
+        case 9: return (double) track.dateAdded;
+        default: return (double) index;
+    }
+}
+
+// function to get the track order for the current sort keys. each order is kept until the tracks change,
+// so switching back to a column sorted before costs nothing
+const std::vector<int>& PlaylistComponent::getSortOrder()
+{
+    String spec;
+    for (auto& key : sortKeys)
+    {
+        spec << key.columnId << (key.forwards ? "+" : "-");
+    }
+
+    auto cached = sortCache.find(spec);
+    if (cached != sortCache.end())
     {
-        // Find all mp3 files from music folder and pushes the files to array
-        musicFolder.findChildFiles(addedFiles, File::findFiles, false, "*.mp3");
-        DBG(addedFiles.size());
+        return cached->second;
+    }
 
-        // Find the number of audio files inside the music folder
-        numOfTracks = musicFolder.getNumberOfChildFiles(File::findFiles, "*.mp3");
+    auto& order = sortCache[spec];
+    order.resize(tracks.size());
+    std::iota(order.begin(), order.end(), 0);
 
-        // Iterate through each file in music folder
-        for (int i = 0; i < numOfTracks; i++)
+    if (sortKeys.isEmpty())
+    {
+        return order;
+    }
+
+    std::vector<const std::vector<double>*> keys;
+    for (auto& key : sortKeys)
+    {
+        keys.push_back(&getKeyColumn(key.columnId));
+    }
+
+    std::sort(order.begin(), order.end(), [this, &keys](int a, int b)
+    {
+        for (size_t k = 0; k < keys.size(); ++k)
         {
-            // Retrieve the track name and push it into respective vector
-            trackTitles.push_back(addedFiles[i].getFileName().toStdString());
-            addedTracks.add(URL{ addedFiles[i] });
+            double keyA = (*keys[k])[(size_t) a];
+            double keyB = (*keys[k])[(size_t) b];
 
-            // Retrieve track duration and is processesed before pushing to array
-            std::string duration = getTrackDur(addedFiles[i]).toStdString();
-            trackDurations.push_back(duration);
+            if (keyA != keyB)
+            {
+                return sortKeys.getReference((int) k).forwards ? keyA < keyB : keyA > keyB;
+            }
         }
+
+        // ties keep the order the tracks were added in
+        return a < b;
+    });
+
+    return order;
+}
+
+// function to read a token such as dur:3:00-, key:8A-9A or added:0-7. either end can be left off
+bool PlaylistComponent::parseRangeFilter(const String& token, RangeFilter& filter)
+{
+    String field = token.upToFirstOccurrenceOf(":", false, true);
+    String range = token.fromFirstOccurrenceOf(":", false, false);
+
+    if (field.isEmpty() || field == token || range.isEmpty())
+    {
+        return false;
+    }
+
+    if (field == "dur" || field == "duration")
+    {
+        filter.columnId = 2;
+    }
+    else if (field == "key")
+    {
+        filter.columnId = 8;
+    }
+    else if (field == "added")
+    {
+        filter.columnId = 9;
     }
     else
     {
-        std::cout << "No music folder found!" << std::endl;
+        return false;
+    }
+
+    String low = range.upToFirstOccurrenceOf("-", false, false).trim();
+    String high = range.containsChar('-') ? range.fromFirstOccurrenceOf("-", false, false).trim() : low;
+
+    auto parse = [&filter](const String& text, double missing)
+    {
+        if (text.isEmpty())
+        {
+            return missing;
+        }
+
+        switch (filter.columnId)
+        {
+            case 2: return parseDuration(text);
+            case 8: return (double) HarmonicIndex::parseKeyName(text);
+            default: return text.getDoubleValue();
+        }
+    };
+
+    // a missing lower end starts at zero, so tracks whose value is still unknown are left out
+    filter.minimum = parse(low, 0.0);
+    filter.maximum = parse(high, std::numeric_limits<double>::infinity());
+
+    // added is typed in whole days ago, so the range is turned round into dates
+    if (filter.columnId == 9)
+    {
+        double now = (double) Time::currentTimeMillis();
+        double day = 24.0 * 60.0 * 60.0 * 1000.0;
+        double newest = now - filter.minimum * day;
+
+        filter.minimum = now - (filter.maximum + 1.0) * day;
+        filter.maximum = newest;
     }
+
+    return true;
 }
 
-// function to get track duration
-String PlaylistComponent::getTrackDur(File file)
+// logic to handle search result
+void PlaylistComponent::findTrack(String searchText)
 {
-    auto reader = formatManager.createReaderFor(file);
-    auto lengthInSeconds = reader->lengthInSamples / reader->sampleRate;
-    int roundedSecs = std::round(lengthInSeconds);
+    // range tokens narrow the table down, any other words are looked for in the titles
+    StringArray words;
+    words.addTokens(searchText, " ", "\"");
 
-    // seconds are converted to mins and remaining secs
-    std::string mins = std::to_string(roundedSecs / 60);
-    std::string secs = std::to_string(roundedSecs % 60);
+    filters.clearQuick();
+    StringArray titleWords;
 
-    // Formatted time
-    std::string duration = mins + ":" + secs;
+    for (auto& word : words)
+    {
+        RangeFilter filter;
+
+        if (parseRangeFilter(word.toLowerCase(), filter))
+        {
+            filters.add(filter);
+        }
+        else if (word.isNotEmpty())
+        {
+            titleWords.add(word);
+        }
+    }
+
+    invalidateView(false);
+    tableComponent.updateContent();
+    tableComponent.repaint();
+
+    // if there is a match, the row is highlighted by change of colour
+    String remaining = titleWords.joinIntoString(" ");
+
+    if (remaining != "")
+    {
+        int rowNumber = getTrackIndex(remaining);
+        tableComponent.selectRow(rowNumber);
+    }
+    else
+    {
+        tableComponent.deselectAllRows();
+    }
+}
+
+// function to search library
+int PlaylistComponent::getTrackIndex(String searchText)
+{
+    // searches the visible rows in table order for a match, then returns the row
+    updateView();
+
+    auto index = find_if(view.begin(), view.end(), [this, &searchText](int track) {return tracks[(size_t) track].title.containsIgnoreCase(searchText); });
+    int i = -1;
+
+    if (index != view.end())
+    {
+        i = (int) std::distance(view.begin(), index);
+    }
+
+    return i;
+}
+
+// function to load track to library
+void PlaylistComponent::loadToLib()
+{
+    // user selects file
+    FileChooser chooser{ "Add files to library" };
+
+    if (chooser.browseForMultipleFilesToOpen())
+    {
+        for (File& selectedFiles : chooser.getResults())
+        {
+            importTrack(selectedFiles);
+        }
+
+        libraryChanged();
+    }
+}
+
+// function to add a single track record to the library
+void PlaylistComponent::addTrack(const File& file, double lengthInSeconds)
+{
+    TrackRecord track;
+    track.file = file;
+    track.url = URL{ file };
+    track.title = file.getFileName();
+    track.lengthInSeconds = lengthInSeconds;
+    track.duration = formatDuration(lengthInSeconds);
+    track.dateAdded = Time::currentTimeMillis();
+
+    rowByPath[file.getFullPathName()] = tracks.size();
+    tracks.push_back(std::move(track));
+    invalidateView(true);
+}
+
+// function to add a track from disk, its analysis is filled in when the background pass finishes
+void PlaylistComponent::importTrack(const File& file)
+{
+    // the same file is only ever in the library once
+    if (findRow(file) >= 0)
+    {
+        return;
+    }
+
+    addTrack(file, getTrackLength(file));
+    tracks.back().fileModified = file.getLastModificationTime().toMilliseconds();
+    analyseTrack(file);
+}
+
+// function to start the background hash and analysis of a track in the library
+void PlaylistComponent::analyseTrack(const File& file)
+{
+    Component::SafePointer<PlaylistComponent> safeThis(this);
+
+    // hashing and analysis both run in parallel across the library, each result is indexed as it arrives
+    duplicateIndex.requestContentHash(file, [safeThis, file](const String& contentHash)
+    {
+        if (safeThis != nullptr)
+        {
+            safeThis->indexContentHash(file, contentHash);
+            safeThis->libraryChangedSoon();
+        }
+    });
+
+    trackAnalyser.requestAnalysis(file, [safeThis, file](std::shared_ptr<const TrackAnalysis> analysis)
+    {
+        // rows may have moved or gone while the analysis ran, so the track is looked up again
+        if (safeThis != nullptr)
+        {
+            int row = safeThis->findRow(file);
+
+            if (row >= 0)
+            {
+                safeThis->tracks[row].analysis = analysis;
+
+                if (analysis != nullptr)
+                {
+                    safeThis->setTrackKey(file, analysis->camelotKey);
+                }
+
+                if (analysis != nullptr && analysis->hasFingerprint)
+                {
+                    double audible = analysis->samplesToSeconds(analysis->lastAudibleSample - analysis->firstAudibleSample);
+                    safeThis->indexFingerprint(file, analysis->fingerprint, audible);
+                }
+
+                // the key and fingerprint are kept in the session
+                if (analysis != nullptr)
+                {
+                    safeThis->libraryChangedSoon();
+                }
+            }
+        }
+    });
+}
+
+int PlaylistComponent::findRow(const File& file) const
+{
+    auto it = rowByPath.find(file.getFullPathName());
+    return it != rowByPath.end() ? (int) it->second : -1;
+}
+
+// function to fold an exact copy into the track it copies
+void PlaylistComponent::indexContentHash(const File& file, const String& contentHash)
+{
+    int row = findRow(file);
+    if (row < 0 || contentHash.isEmpty())
+    {
+        return;
+    }
+
+    tracks[row].contentHash = contentHash;
+
+    int originalRow = findRow(duplicateIndex.addContentHash(file, contentHash));
+
+    if (originalRow >= 0 && originalRow != row)
+    {
+        mergeTracks(row, originalRow);
+    }
+}
+
+// function to flag a track that sounds the same as one already in the library
+void PlaylistComponent::indexFingerprint(const File& file, uint64 fingerprint, double audibleSeconds)
+{
+    int row = findRow(file);
+    if (row < 0)
+    {
+        return;
+    }
+
+    auto& track = tracks[row];
+    track.fingerprint = fingerprint;
+    track.hasFingerprint = true;
+    track.audibleSeconds = audibleSeconds;
+    track.nearDuplicateOf = duplicateIndex.addFingerprint(file, fingerprint, audibleSeconds);
+
+    tableComponent.repaint();
+}
+
+// function to merge one row into another. the merged row's files are remembered by the row that stays
+void PlaylistComponent::mergeTracks(int row, int intoRow)
+{
+    auto& keeper = tracks[intoRow];
+    keeper.mergedFiles.addIfNotAlreadyThere(tracks[row].file);
+
+    for (auto& merged : tracks[row].mergedFiles)
+    {
+        keeper.mergedFiles.addIfNotAlreadyThere(merged);
+    }
+
+    deleteTrack(row);
+}
+
+// function to record a track's key and index it for suggestions
+void PlaylistComponent::setTrackKey(const File& file, int camelotKey)
+{
+    int row = findRow(file);
+    if (row < 0 || camelotKey < 0)
+    {
+        return;
+    }
+
+    auto& track = tracks[(size_t) row];
+    track.camelotKey = camelotKey;
+    harmonicIndex.add(file, camelotKey);
+    invalidateColumn(8, row);
+
+    // the key of a loaded track changes every suggestion, any other track only needs checking against the decks
+    if (file == deckFiles[0] || file == deckFiles[1])
+    {
+        updateSuggestions();
+        return;
+    }
+
+    // a track analysed again may have had a different key, so its old suggestions are not kept
+    track.suggestedFor = 0;
+
+    for (int deck = 0; deck < 2; ++deck)
+    {
+        int deckKey = getDeckKey(deck);
+        auto compatible = HarmonicIndex::getCompatibleKeys(deckKey);
+
+        if (deckKey >= 0 && std::find(compatible.begin(), compatible.end(), camelotKey) != compatible.end())
+        {
+            track.suggestedFor |= (uint8) (1 << deck);
+            suggestedFiles.addIfNotAlreadyThere(file);
+        }
+    }
+
+    tableComponent.repaint();
+}
+
+void PlaylistComponent::setDeckTrack(int deck, const File& file, int camelotKey)
+{
+    deckFiles[deck] = file;
+    deckKeys[deck] = camelotKey;
+    updateSuggestions();
+}
+
+// function to mark the tracks that mix with each deck. the previous suggestions are cleared by file and
+// the new ones come from the key index, so the rest of the library is not touched
+void PlaylistComponent::updateSuggestions()
+{
+    for (auto& file : suggestedFiles)
+    {
+        int row = findRow(file);
+        if (row >= 0)
+        {
+            tracks[(size_t) row].suggestedFor = 0;
+        }
+    }
+
+    suggestedFiles.clearQuick();
+
+    for (int deck = 0; deck < 2; ++deck)
+    {
+        for (auto& file : harmonicIndex.findCompatible(getDeckKey(deck), deckFiles[deck]))
+        {
+            int row = findRow(file);
+            if (row >= 0)
+            {
+                tracks[(size_t) row].suggestedFor |= (uint8) (1 << deck);
+                suggestedFiles.add(file);
+            }
+        }
+    }
+
+    if (libSuggestBtn.getToggleState())
+    {
+        invalidateView(false);
+        tableComponent.updateContent();
+    }
+
+    tableComponent.repaint();
+}
+
+// a library track on a deck goes by its indexed key, which may have come in after it was loaded
+int PlaylistComponent::getDeckKey(int deck) const
+{
+    int key = harmonicIndex.getKey(deckFiles[deck]);
+    return key >= 0 ? key : deckKeys[deck];
+}
+
+void PlaylistComponent::libraryChanged()
+{
+    // anything still waiting is covered by this change
+    stopTimer();
+
+    if (onLibraryChanged != nullptr)
+    {
+        onLibraryChanged();
+    }
+}
+
+void PlaylistComponent::libraryChangedSoon()
+{
+    // results coming in together are reported at most once a second, so a long import is still saved as it goes
+    if (!isTimerRunning())
+    {
+        startTimer(1000);
+    }
+}
+
+void PlaylistComponent::timerCallback()
+{
+    libraryChanged();
+}
+
+void PlaylistComponent::flushLibraryChange()
+{
+    if (isTimerRunning())
+    {
+        libraryChanged();
+    }
+}
+
+// function to capture the library for the session
+ValueTree PlaylistComponent::getState() const
+{
+    return makeState(tracks, folderWatcher.getFolders());
+}
+
+// function to copy the library for the session writer. the copy shares nothing the library changes in place,
+// so the tree can be built and serialised while the library carries on changing
+std::function<ValueTree()> PlaylistComponent::getStateBuilder() const
+{
+    auto snapshot = std::make_shared<const std::vector<TrackRecord>>(tracks);
+    Array<File> folders = folderWatcher.getFolders();
+
+    return [snapshot, folders] {return makeState(*snapshot, folders);};
+}
+
+ValueTree PlaylistComponent::makeState(const std::vector<TrackRecord>& tracks, const Array<File>& folders)
+{
+    ValueTree state{ "LIBRARY" };
+
+    // the length, hash and fingerprint are kept so a restored library needs no decoding
+    for (auto& track : tracks)
+    {
+        ValueTree trackState{ "TRACK", { { "path", track.file.getFullPathName() }, { "length", track.lengthInSeconds }, { "added", track.dateAdded } } };
+
+        if (track.fileModified != 0)
+        {
+            trackState.setProperty("modified", track.fileModified, nullptr);
+        }
+
+        if (track.contentHash.isNotEmpty())
+        {
+            trackState.setProperty("hash", track.contentHash, nullptr);
+        }
+
+        if (track.camelotKey >= 0)
+        {
+            trackState.setProperty("key", track.camelotKey, nullptr);
+        }
+
+        if (track.hasFingerprint)
+        {
+            trackState.setProperty("fingerprint", (int64) track.fingerprint, nullptr);
+            trackState.setProperty("audible", track.audibleSeconds, nullptr);
+        }
+
+        for (auto& merged : track.mergedFiles)
+        {
+            trackState.appendChild(ValueTree{ "MERGED", { { "path", merged.getFullPathName() } } }, nullptr);
+        }
+
+        for (auto& dismissed : track.dismissedDuplicates)
+        {
+            trackState.appendChild(ValueTree{ "DISMISSED", { { "path", dismissed.getFullPathName() } } }, nullptr);
+        }
+
+        state.appendChild(trackState, nullptr);
+    }
+
+    for (auto& folder : folders)
+    {
+        state.appendChild(ValueTree{ "WATCHED", { { "path", folder.getFullPathName() } } }, nullptr);
+    }
+
+    return state;
+}
+
+// function to rebuild the library from a saved session
+void PlaylistComponent::restoreState(const ValueTree& state)
+{
+    if (!state.hasType("LIBRARY"))
+    {
+        return;
+    }
+
+    tracks.clear();
+    rowByPath.clear();
+    duplicateIndex.clear();
+    harmonicIndex.clear();
+    suggestedFiles.clearQuick();
+    tracks.reserve((size_t) state.getNumChildren());
+
+    Array<File> watchedFolders;
+
+    for (const auto& child : state)
+    {
+        if (child.hasType("TRACK"))
+        {
+            // sessions saved before lengths were stored as numbers only have the m:ss text
+            File file{ child["path"].toString() };
+            addTrack(file, child.hasProperty("length") ? (double) child["length"] : parseDuration(child["duration"].toString()));
+
+            auto& track = tracks.back();
+            track.contentHash = child["hash"].toString();
+            track.dateAdded = child.getProperty("added", track.dateAdded);
+            track.fileModified = (int64) child.getProperty("modified", 0);
+
+            for (const auto& other : child)
+            {
+                File otherFile{ other["path"].toString() };
+
+                // dismissals go into the index before the fingerprint does, so the pair is never flagged again
+                if (other.hasType("DISMISSED"))
+                {
+                    track.dismissedDuplicates.add(otherFile);
+                    duplicateIndex.dismiss(file, otherFile);
+                }
+                else
+                {
+                    track.mergedFiles.add(otherFile);
+                }
+            }
+
+            // saved results go straight back into the index, nothing is hashed again
+            duplicateIndex.addContentHash(file, track.contentHash);
+
+            if (child.hasProperty("key"))
+            {
+                track.camelotKey = child["key"];
+                harmonicIndex.add(file, track.camelotKey);
+            }
+
+            if (child.hasProperty("fingerprint"))
+            {
+                indexFingerprint(file, (uint64) (int64) child["fingerprint"], child["audible"]);
+            }
+        }
+        else if (child.hasType("WATCHED"))
+        {
+            File folder{ child["path"].toString() };
+            folderWatcher.addFolder(folder);
+            watchedFolders.add(folder);
+        }
+    }
+
+    invalidateView(true);
+    updateSuggestions();
+    tableComponent.updateContent();
+    tableComponent.repaint();
+
+    catchUpWatchedFolders(watchedFolders);
+}
+
+TableListBox& PlaylistComponent::getTable()
+{
+    return tableComponent;
+}
+
+// function to save track to library
+void PlaylistComponent::saveLib()
+{
+    // the job works on its own copy of the file list, so the library can keep changing while it runs
+    Array<File> filesToSync;
+    for (auto& track : tracks)
+    {
+        filesToSync.add(track.file);
+    }
+
+    File folder = musicFolder;
+
+    syncPool.addJob([filesToSync, folder]
+    {
+        std::multimap<int64, File> folderFilesBySize;
+        for (const auto& entry : RangedDirectoryIterator(folder, false, "*", File::findFiles))
+        {
+            folderFilesBySize.emplace(entry.getFileSize(), entry.getFile());
+        }
+
+        for (auto& file : filesToSync)
+        {
+            // files are added to folder, unless an identical copy is already there under any name
+            if (isAlreadySynced(file, folderFilesBySize))
+            {
+                continue;
+            }
+
+            // a different track with the same name is kept, the new one gets a numbered name beside it
+            File dest = folder.getChildFile(file.getFileName());
+            if (dest.exists())
+            {
+                dest = dest.getNonexistentSibling();
+            }
+
+            if (file.copyFileTo(dest))
+            {
+                folderFilesBySize.emplace(dest.getSize(), dest);
+                DBG("Track copied");
+            }
+            else {
+                DBG("Track not copied");
+            }
+        }
+    });
+}
+
+// function to load from file to library
+void PlaylistComponent::loadLib()
+{
+    if (musicFolder.isDirectory())
+    {
+        // Find every file one of the registered decoders can read
+        Array<File> folderFiles;
+        musicFolder.findChildFiles(folderFiles, File::findFiles, false, metadataService.getFormatManager().getWildcardForAllFormats());
+        DBG(folderFiles.size());
+
+        // Iterate through each file in music folder
+        for (auto& file : folderFiles)
+        {
+            importTrack(file);
+        }
+
+        libraryChanged();
+    }
+    else
+    {
+        std::cout << "No music folder found!" << std::endl;
+    }
+}
+
+// function to add a folder to the watch list
+void PlaylistComponent::watchFolder()
+{
+    FileChooser chooser{ "Watch a music folder" };
+
+    if (chooser.browseForDirectory())
+    {
+        File folder = chooser.getResult();
+
+        // tracks already in the folder are added once, after that only changes are applied
+        for (const auto& entry : RangedDirectoryIterator(folder, false, metadataService.getFormatManager().getWildcardForAllFormats(), File::findFiles))
+        {
+            if (findRow(entry.getFile()) < 0)
+            {
+                importTrack(entry.getFile());
+            }
+        }
+
+        folderWatcher.addFolder(folder);
+        libraryChanged();
+    }
+}
+
+// function to apply a single change reported by the folder watcher
+void PlaylistComponent::applyFolderChange(const File& file, FolderWatcher::FileChange change)
+{
+    // whatever happened, a pooled reader or an analysis of the old contents is no use any more
+    metadataService.invalidate(file);
+    trackAnalyser.invalidate(file);
+
+    int row = findRow(file);
+
+    if (change == FolderWatcher::FileChange::removed)
+    {
+        if (row >= 0)
+        {
+            deleteTrack(row);
+        }
+        return;
+    }
+
+    if (row >= 0)
+    {
+        // modified in place, so its duration and analysis are read again without losing the row
+        reanalyseTrack(row, getTrackLength(file));
+    }
+    else
+    {
+        importTrack(file);
+    }
+
+    tableComponent.updateContent();
+    tableComponent.repaint();
+    libraryChanged();
+}
+
+// function to read a rewritten track again. it keeps its row, so its date added and merged copies survive
+void PlaylistComponent::reanalyseTrack(int row, double lengthInSeconds)
+{
+    auto& track = tracks[(size_t) row];
+    File file = track.file;
+
+    // the old contents are taken out of every index, the new results put them back as they arrive
+    duplicateIndex.remove(file);
+    harmonicIndex.remove(file);
+
+    track.lengthInSeconds = lengthInSeconds;
+    track.duration = formatDuration(lengthInSeconds);
+    track.fileModified = file.getLastModificationTime().toMilliseconds();
+    track.camelotKey = -1;
+    track.analysis = nullptr;
+    track.contentHash = String();
+    track.fingerprint = 0;
+    track.hasFingerprint = false;
+    track.nearDuplicateOf = File();
+    track.suggestedFor = 0;
+
+    for (auto& other : tracks)
+    {
+        if (other.nearDuplicateOf == file)
+        {
+            other.nearDuplicateOf = File();
+        }
+    }
+
+    invalidateView(true);
+    analyseTrack(file);
+}
+
+// function to compare the watched folders with the library after a restore. the watcher only reports what
+// happens from now on, so files added, rewritten or deleted since the session was saved are found here
+void PlaylistComponent::catchUpWatchedFolders(const Array<File>& folders)
+{
+    if (folders.isEmpty())
+    {
+        return;
+    }
+
+    // the job works on its own copy of what the library knows. copies folded into a row count as known
+    auto known = std::make_shared<std::unordered_map<String, int64>>();
+    known->reserve(tracks.size());
+
+    for (auto& track : tracks)
+    {
+        (*known)[track.file.getFullPathName()] = track.fileModified;
+
+        for (auto& merged : track.mergedFiles)
+        {
+            known->emplace(merged.getFullPathName(), -1);
+        }
+    }
+
+    struct FileLength
+    {
+        File file;
+        double lengthInSeconds;
+    };
+
+    struct CatchUp
+    {
+        std::vector<FileLength> added;
+        std::vector<FileLength> written;
+        Array<File> removed;
+        std::vector<std::pair<File, int64>> stamped;
+    };
+
+    Component::SafePointer<PlaylistComponent> safeThis(this);
+    TrackMetadataService& metadata = metadataService;
+    String wildcard = metadataService.getFormatManager().getWildcardForAllFormats();
+
+    syncPool.addJob([safeThis, &metadata, known, folders, wildcard]
+    {
+        auto result = std::make_shared<CatchUp>();
+
+        auto readLength = [&metadata](const File& file)
+        {
+            TrackMetadata header;
+            return metadata.readMetadata(file, header) ? header.lengthInSeconds : -1.0;
+        };
+
+        for (auto& folder : folders)
+        {
+            for (const auto& entry : RangedDirectoryIterator(folder, false, wildcard, File::findFiles))
+            {
+                File file = entry.getFile();
+                int64 modified = entry.getModificationTime().toMilliseconds();
+                auto it = known->find(file.getFullPathName());
+
+                if (it == known->end())
+                {
+                    result->added.push_back({ file, readLength(file) });
+                }
+                else if (it->second == 0)
+                {
+                    // saved before modification times were kept, so this time becomes the one to compare against
+                    result->stamped.emplace_back(file, modified);
+                }
+                else if (it->second > 0 && it->second != modified)
+                {
+                    result->written.push_back({ file, readLength(file) });
+                }
+            }
+        }
+
+        for (auto& entry : *known)
+        {
+            File file{ entry.first };
+
+            if (entry.second >= 0 && folders.contains(file.getParentDirectory()) && !file.existsAsFile())
+            {
+                result->removed.add(file);
+            }
+        }
+
+        MessageManager::callAsync([safeThis, result]
+        {
+            if (safeThis == nullptr)
+            {
+                return;
+            }
+
+            // rows may have changed while the job ran, so each file is looked up again
+            for (auto& stamp : result->stamped)
+            {
+                int row = safeThis->findRow(stamp.first);
+                if (row >= 0)
+                {
+                    safeThis->tracks[(size_t) row].fileModified = stamp.second;
+                }
+            }
+
+            for (auto& file : result->removed)
+            {
+                int row = safeThis->findRow(file);
+                if (row >= 0)
+                {
+                    safeThis->deleteTrack(row);
+                }
+            }
+
+            for (auto& entry : result->written)
+            {
+                safeThis->metadataService.invalidate(entry.file);
+                safeThis->trackAnalyser.invalidate(entry.file);
+
+                int row = safeThis->findRow(entry.file);
+                if (row >= 0)
+                {
+                    safeThis->reanalyseTrack(row, entry.lengthInSeconds);
+                }
+            }
+
+            for (auto& entry : result->added)
+            {
+                if (safeThis->findRow(entry.file) < 0)
+                {
+                    safeThis->addTrack(entry.file, entry.lengthInSeconds);
+                    safeThis->tracks.back().fileModified = entry.file.getLastModificationTime().toMilliseconds();
+                    safeThis->analyseTrack(entry.file);
+                }
+            }
+
+            safeThis->tableComponent.updateContent();
+            safeThis->tableComponent.repaint();
+
+            // the stamps are worth keeping even when nothing else changed
+            if (!result->added.empty() || !result->written.empty() || !result->removed.isEmpty() || !result->stamped.empty())
+            {
+                safeThis->libraryChangedSoon();
+            }
+        });
+    });
+}
+
+// function to get track length in seconds
+double PlaylistComponent::getTrackLength(File file)
+{
+    // only the header is read, using a pooled reader where possible
+    TrackMetadata metadata;
+    if (!metadataService.readMetadata(file, metadata))
+    {
+        return -1.0;
+    }
 
-    delete reader;
-    return duration;
+    return metadata.lengthInSeconds;
 }
\ No newline at end of file
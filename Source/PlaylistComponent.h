@@ -4,17 +4,80 @@
 #include "DJAudioPlayer.h"
 #include "WaveformDisplay.h"
 #include "DeckGUI.h"
+#include "TrackMetadataService.h"
+#include "FolderWatcher.h"
+#include "DuplicateIndex.h"
+#include "HarmonicIndex.h"
 
 #include <vector>
 #include <string>
+#include <map>
+#include <unordered_map>
 
 //==============================================================================
 /*
+    Button used in the action columns of the library table. The table only
+    keeps components for the rows on screen, so when a row scrolls out its
+    buttons are handed back to us and rebound to another row number.
 */
-class PlaylistComponent : public juce::Component, public juce::TableListBoxModel, public juce::Button::Listener
+class RowActionButton : public TextButton
 {
 public:
-    PlaylistComponent(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, DJAudioPlayer* _playerForParsingMetaData);
+    RowActionButton(const String& buttonName);
+
+    void setRow(int newRow);
+    int getRow() const;
+
+private:
+    int row = -1;
+};
+
+//==============================================================================
+/*
+    One track in the library.
+*/
+struct TrackRecord
+{
+    File file;
+    URL url;
+    String title;
+
+    // the sortable values are kept as numbers, duration is only formatted for display
+    String duration;
+    double lengthInSeconds = -1.0;
+    int camelotKey = -1; // 0-23 for 1A, 1B, 2A ... 12B, -1 while unknown
+    int64 dateAdded = 0; // milliseconds since the epoch
+    int64 fileModified = 0; // the file's modification time when it was last read, 0 if not known
+
+    // filled in once the background analysis has run
+    std::shared_ptr<const TrackAnalysis> analysis;
+
+    // duplicate detection, filled in during import and kept in the session
+    String contentHash;
+    uint64 fingerprint = 0;
+    bool hasFingerprint = false;
+    double audibleSeconds = 0.0;
+
+    // exact copies found on import, folded into this row
+    Array<File> mergedFiles;
+
+    // a track that sounds the same, waiting for the user to merge it or dismiss it
+    File nearDuplicateOf;
+
+    // tracks the user has said are not the same as this one, kept in the session so they stay dismissed
+    Array<File> dismissedDuplicates;
+
+    // bit 0 set when it mixes with the track on deck 1, bit 1 for deck 2
+    uint8 suggestedFor = 0;
+};
+
+//==============================================================================
+/*
+*/
+class PlaylistComponent : public juce::Component, public juce::TableListBoxModel, public juce::Button::Listener, private juce::Timer
+{
+public:
+    PlaylistComponent(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2, TrackMetadataService& _metadataService, TrackAnalyser& _trackAnalyser);
     ~PlaylistComponent() override;
 
     void paint (juce::Graphics&) override;
@@ -23,47 +86,155 @@ public:
     int getNumRows() override;
     void paintRowBackground(Graphics&, int rowNumber, int width, int height, bool rowIsSelected) override;
     void paintCell(Graphics&, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
-    Component* refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected, Component* existingComponentToUpdate);
+    Component* refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected, Component* existingComponentToUpdate) override;
     void buttonClicked(Button* button) override;
 
+    /** double clicking a row previews it in the headphones */
+    void cellDoubleClicked(int rowNumber, int columnId, const MouseEvent&) override;
+
+    /** right clicking a flagged row offers to merge it with the track it duplicates */
+    void cellClicked(int rowNumber, int columnId, const MouseEvent&) override;
+
+    /** clicking a header sorts by it, earlier sort columns break ties */
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override;
+
+    /** adds a track row to the library. the length is in seconds, negative if it could not be read */
+    void addTrack(const File& file, double lengthInSeconds);
+
+    /** tells the library what a deck has loaded, so tracks in a compatible key can be suggested. deck is 0 or 1 */
+    void setDeckTrack(int deck, const File& file, int camelotKey);
+
+    /** called when a track's Queue button is clicked, to hand it to the auto-DJ */
+    std::function<void(const File&)> onQueueTrack;
+
+    /** the library and watched folders, for the session. restoring only reads audio files that changed in a
+        watched folder while the app was closed */
+    ValueTree getState() const;
+    void restoreState(const ValueTree& state);
+
+    /** copies the library and returns what getState would build from it, so a large library can be turned
+        into a tree on another thread */
+    std::function<ValueTree()> getStateBuilder() const;
+
+    /** called whenever tracks are added or removed, and shortly after background results change a track */
+    std::function<void()> onLibraryChanged;
+
+    /** reports a change still waiting to be gathered up straight away, e.g. on the way out */
+    void flushLibraryChange();
+
+    /** the library table, exposed for the benchmarks */
+    TableListBox& getTable();
+
+    /** what the track finder and the row buttons do, exposed for the benchmarks. rows are table rows */
+    void findTrack(String searchText);
+    int getTrackIndex(String searchText);
+    void handleRowAction(int columnId, int rowNumber);
+
 private:
-    AudioFormatManager formatManager;
     FileChooser fChooser{ "Select a file..." };
     TableListBox tableComponent;
 
-    double duration;
-
-    Array<URL> addedTracks;
-    Array<File> addedFiles;
-    std::vector<std::string> trackTitles; // to store track titles
-
-    std::vector<std::string> testArray; // to store track titles
+    std::vector<TrackRecord> tracks; // every track in the library, in the order it was added
+    std::unordered_map<String, size_t> rowByPath; // index into tracks for each file
+
+    // a range on one of the numeric columns, typed into the track finder as e.g. dur:3:00-6:00
+    struct RangeFilter
+    {
+        int columnId;
+        double minimum;
+        double maximum;
+    };
+
+    struct SortKey
+    {
+        int columnId;
+        bool forwards;
+    };
+
+    static constexpr int maxSortKeys = 3;
+
+    // the table shows view, an index into tracks for each row on screen. it is rebuilt from a cached
+    // sort order when the sort or filters change, and the caches are dropped when tracks change
+    std::vector<int> view;
+    bool viewDirty = true;
+    Array<SortKey> sortKeys; // most recent click first
+    Array<RangeFilter> filters;
+    std::map<int, std::vector<double>> keyColumns; // one number per track for each sortable column
+    std::map<String, std::vector<int>> sortCache; // track order for each sort spec, e.g. "2+1-"
+
+    void invalidateView(bool tracksChanged);
+    void invalidateColumn(int columnId, int index);
+    void updateView();
+    int getTrackForRow(int row);
+    const std::vector<double>& getKeyColumn(int columnId);
+    double getKeyValue(int columnId, size_t index) const;
+    const std::vector<int>& getSortOrder();
+    static bool parseRangeFilter(const String& token, RangeFilter& filter);
 
     DeckGUI* deckGUI1;
     DeckGUI* deckGUI2;
-    DJAudioPlayer* playerForParsingMetaData;
+    TrackMetadataService& metadataService;
+    TrackAnalyser& trackAnalyser;
+    DuplicateIndex duplicateIndex;
+    HarmonicIndex harmonicIndex;
+    FolderWatcher folderWatcher{ metadataService.getFormatManager().getWildcardForAllFormats() };
+
+    // copies into the music folder happen here, off the message thread
+    ThreadPool syncPool{ 1 };
 
     TextButton libLoadBtn{ "Load into library" };
     TextButton libSaveBtn{ "Save Tracks" };
     TextButton libRestoreBtn{ "Load Tracks" };
+    TextButton libWatchBtn{ "Watch Folder" };
+    TextButton libSuggestBtn{ "Suggestions" };
+
+    // what each deck has loaded and its key, and the files currently suggested for them
+    File deckFiles[2];
+    int deckKeys[2] = { -1, -1 };
+    Array<File> suggestedFiles;
+
+    double getTrackLength(File file);
 
-    String getTrackDur(File file);
+    /** adds a track from disk and starts analysing it in the background */
+    void importTrack(const File& file);
 
-    std::vector<std::string> trackDurations;
+    /** hashes and analyses a track already in the library, indexing each result as it arrives */
+    void analyseTrack(const File& file);
 
-    void loadIntoDeck1();
-    void loadIntoDeck2();
-    void deleteTrack();
+    /** reads a track again after its file was rewritten, keeping its row, date added and merged copies */
+    void reanalyseTrack(int row, double lengthInSeconds);
+    int findRow(const File& file) const;
+
+    /** called as the hash and fingerprint of an imported track come in */
+    void indexContentHash(const File& file, const String& contentHash);
+    void indexFingerprint(const File& file, uint64 fingerprint, double audibleSeconds);
+    void mergeTracks(int row, int intoRow);
+    void setTrackKey(const File& file, int camelotKey);
+    void updateSuggestions();
+    int getDeckKey(int deck) const;
+    void libraryChanged();
+    static ValueTree makeState(const std::vector<TrackRecord>& tracks, const Array<File>& folders);
+
+    /** hashes and analyses arrive one track at a time, so they are gathered into one change */
+    void libraryChangedSoon();
+    void timerCallback() override;
+
+    void loadIntoDeck1(int row);
+    void loadIntoDeck2(int row);
+    void deleteTrack(int row);
 
     TextEditor trackFinder;
-    void findTrack(String searchText);
-    int getTrackIndex(String searchText);
 
     void loadToLib();
     void saveLib();
     void loadLib();
+    void watchFolder();
+    void applyFolderChange(const File& file, FolderWatcher::FileChange change);
+
+    /** applies whatever happened in the watched folders while the app was closed. the folders are scanned
+        and new headers read on a background thread, the results are applied on the message thread */
+    void catchUpWatchedFolders(const Array<File>& folders);
     File musicFolder = File::getSpecialLocation(File::userDesktopDirectory).getFullPathName() + "/music-folder";
 
-    double rowSelected;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaylistComponent)
 };
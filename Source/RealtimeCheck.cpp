@@ -0,0 +1,148 @@
+#include "RealtimeCheck.h"
+#include <cstdlib>
+#include <new>
+
+#if JUCE_DEBUG && JUCE_LINUX
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace
+{
+    // plain thread locals, so reading them from inside the hooks never allocates or locks
+    thread_local bool checking = false;
+
+    std::atomic<int> allocations{ 0 };
+    std::atomic<int> locks{ 0 };
+}
+
+//==============================================================================
+bool RealtimeCheck::isActive()
+{
+   #if JUCE_DEBUG
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+int RealtimeCheck::getNumAllocations()
+{
+    return allocations.load();
+}
+
+int RealtimeCheck::getNumLocks()
+{
+    return locks.load();
+}
+
+void RealtimeCheck::noteAllocation()
+{
+    if (checking)
+    {
+        noteViolation(allocations);
+    }
+}
+
+void RealtimeCheck::noteLock()
+{
+    if (checking)
+    {
+        noteViolation(locks);
+    }
+}
+
+void RealtimeCheck::noteViolation(std::atomic<int>& counter)
+{
+    ++counter;
+
+    // the assertion logs, which allocates, so the check is off until it returns
+    checking = false;
+    jassertfalse;
+    checking = true;
+}
+
+//==============================================================================
+RealtimeCheck::ScopedRealtimeSection::ScopedRealtimeSection(bool shouldCheck) : wasChecking(checking)
+{
+    checking = isActive() && shouldCheck;
+}
+
+RealtimeCheck::ScopedRealtimeSection::~ScopedRealtimeSection()
+{
+    checking = wasChecking;
+}
+
+//==============================================================================
+#if JUCE_DEBUG
+
+void* operator new(std::size_t size)
+{
+    RealtimeCheck::noteAllocation();
+
+    if (void* block = std::malloc(size > 0 ? size : 1))
+    {
+        return block;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeCheck::noteAllocation();
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+#if JUCE_LINUX
+
+// every mutex in the process, JUCE's CriticalSection included, is locked through here. the real function is
+// looked up without a static local, whose guard would itself take a lock
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    using LockFunction = int (*)(pthread_mutex_t*);
+    static std::atomic<LockFunction> realLock{ nullptr };
+
+    LockFunction lock = realLock.load(std::memory_order_acquire);
+    if (lock == nullptr)
+    {
+        lock = reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        realLock.store(lock, std::memory_order_release);
+    }
+
+    RealtimeCheck::noteLock();
+    return lock(mutex);
+}
+
+#endif
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/*
+    Debug-build checker for the audio thread. Code that must be real-time safe
+    runs inside a ScopedRealtimeSection. In debug builds global operator new
+    is replaced, and on Linux pthread_mutex_lock is interposed, so any heap
+    allocation or mutex lock taken inside a section is counted and stops in
+    the debugger. Release builds compile all of this away.
+*/
+class RealtimeCheck
+{
+public:
+    /** true when allocations and locks are being trapped in this build */
+    static bool isActive();
+
+    /** allocations and locks seen inside sections since the program started */
+    static int getNumAllocations();
+    static int getNumLocks();
+
+    /** called by the hooks. counts the violation if the calling thread is inside a section */
+    static void noteAllocation();
+    static void noteLock();
+
+    //==============================================================================
+    /*
+        Marks the calling thread as real-time for as long as it exists. Sections
+        can be switched off, e.g. while a path still known to lock is in use.
+    */
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection(bool shouldCheck = true);
+        ~ScopedRealtimeSection();
+
+    private:
+        bool wasChecking;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeSection)
+    };
+
+private:
+    static void noteViolation(std::atomic<int>& counter);
+};
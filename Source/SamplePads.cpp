@@ -0,0 +1,553 @@
+#include "SamplePads.h"
+#include <algorithm>
+
+//==============================================================================
+SamplePads::SamplePads()
+{
+    for (int pad = 0; pad < numPads; ++pad)
+    {
+        padSamples[(size_t) pad].store(nullptr);
+        padLooping[(size_t) pad].store(false);
+    }
+}
+
+SamplePads::~SamplePads()
+{
+    stopTimer();
+}
+
+void SamplePads::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    // samples keep their own rate and are stepped through at the device's, so nothing is decoded again here
+    outputRate = sampleRate;
+    level.prepare(sampleRate);
+}
+
+void SamplePads::releaseResources()
+{
+}
+
+void SamplePads::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    ++renderCount;
+
+    bufferToFill.clearActiveBufferRegion();
+
+    int numSamples = bufferToFill.numSamples;
+    int64 blockStart = sampleClock.load();
+
+    // a voice whose pad has been given another sample stops here, before anything reads the old one
+    for (auto& voice : voices)
+    {
+        if (voice.sample != nullptr && voice.sample != padSamples[(size_t) voice.pad].load())
+        {
+            voice.sample = nullptr;
+        }
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1 + size2 && numScheduled < fifoSize; ++i)
+    {
+        scheduled[(size_t) numScheduled++] = triggers[(size_t) (i < size1 ? start1 + i : start2 + i - size1)];
+    }
+
+    fifo.finishedRead(size1 + size2);
+
+    // triggers due in this block start on their own sample, later ones wait for their block
+    for (int i = 0; i < numScheduled;)
+    {
+        auto& pending = scheduled[(size_t) i];
+
+        if (pending.sampleTime >= blockStart + numSamples)
+        {
+            ++i;
+            continue;
+        }
+
+        startVoice(pending.pad, pending.velocity, (int) jmax((int64) 0, pending.sampleTime - blockStart));
+        pending = scheduled[(size_t) --numScheduled];
+    }
+
+    int sounding = 0;
+
+    for (auto& voice : voices)
+    {
+        if (voice.sample != nullptr)
+        {
+            renderVoice(voice, *bufferToFill.buffer, bufferToFill.startSample, numSamples);
+        }
+
+        if (voice.sample != nullptr)
+        {
+            sounding |= 1 << voice.pad;
+        }
+    }
+
+    level.updateTarget();
+    double startLevel = level.getCurrentValue();
+
+    if (level.isSmoothing())
+    {
+        bufferToFill.buffer->applyGainRamp(bufferToFill.startSample, numSamples, (float) startLevel, (float) level.skip(numSamples));
+    }
+    else if (startLevel != 1.0)
+    {
+        bufferToFill.buffer->applyGain(bufferToFill.startSample, numSamples, (float) startLevel);
+    }
+
+    soundingPads.store(sounding);
+    sampleClock.store(blockStart + numSamples);
+
+    ++renderCount;
+}
+
+void SamplePads::startVoice(int pad, float velocity, int delay)
+{
+    const Sample* sample = padSamples[(size_t) pad].load();
+    if (sample == nullptr)
+    {
+        return;
+    }
+
+    // a looping pad is a toggle, pressing it again while it plays lets it fade out
+    if (padLooping[(size_t) pad].load())
+    {
+        bool released = false;
+
+        for (auto& voice : voices)
+        {
+            if (voice.sample != nullptr && voice.pad == pad && voice.release < 0)
+            {
+                voice.release = releaseSamples;
+                released = true;
+            }
+        }
+
+        if (released)
+        {
+            return;
+        }
+    }
+
+    // a free voice if there is one, otherwise the one that has been playing longest
+    Voice* chosen = &voices[0];
+
+    for (auto& voice : voices)
+    {
+        if (voice.sample == nullptr)
+        {
+            chosen = &voice;
+            break;
+        }
+
+        if (voice.startedAt < chosen->startedAt)
+        {
+            chosen = &voice;
+        }
+    }
+
+    chosen->sample = sample;
+    chosen->pad = pad;
+    chosen->position = 0.0;
+    chosen->gain = jlimit(0.0f, 1.0f, velocity);
+    chosen->delay = delay;
+    chosen->release = -1;
+    chosen->startedAt = sampleClock.load() + delay;
+}
+
+void SamplePads::renderVoice(Voice& voice, AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    int skip = jmin(voice.delay, numSamples);
+    voice.delay -= skip;
+
+    const auto& audio = voice.sample->audio;
+    int length = audio.getNumSamples();
+    bool looping = padLooping[(size_t) voice.pad].load();
+    double step = voice.sample->sampleRate / outputRate;
+
+    const float* in[2] = { audio.getReadPointer(0), audio.getReadPointer(jmin(1, audio.getNumChannels() - 1)) };
+    int numOutputs = jmin(2, buffer.getNumChannels());
+
+    for (int i = skip; i < numSamples; ++i)
+    {
+        auto index = (int) voice.position;
+
+        if (index >= length)
+        {
+            if (!looping)
+            {
+                voice.sample = nullptr;
+                return;
+            }
+
+            voice.position -= length;
+            index -= length;
+        }
+
+        // linear interpolation is plenty for short hits. a loop reads across its own join
+        int next = index + 1 < length ? index + 1 : (looping ? 0 : index);
+        float frac = (float) (voice.position - index);
+        float gain = voice.gain;
+
+        if (voice.release >= 0)
+        {
+            if (voice.release == 0)
+            {
+                voice.sample = nullptr;
+                return;
+            }
+
+            gain *= (float) voice.release-- / releaseSamples;
+        }
+
+        for (int ch = 0; ch < numOutputs; ++ch)
+        {
+            float value = in[ch][index] + (in[ch][next] - in[ch][index]) * frac;
+            buffer.addSample(ch, startSample + i, value * gain);
+        }
+
+        voice.position += step;
+    }
+}
+
+std::shared_ptr<SamplePads::Sample> SamplePads::loadSample(AudioFormatManager& formatManager, const File& file)
+{
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->lengthInSamples > (int64) (maxSampleSeconds * reader->sampleRate))
+    {
+        return nullptr;
+    }
+
+    auto sample = std::make_shared<Sample>();
+    sample->audio.setSize(jlimit(1, 2, (int) reader->numChannels), (int) reader->lengthInSamples);
+    sample->sampleRate = reader->sampleRate;
+    sample->file = file;
+
+    reader->read(&sample->audio, 0, (int) reader->lengthInSamples, 0, true, true);
+    return sample;
+}
+
+void SamplePads::setSample(int pad, std::shared_ptr<Sample> sample)
+{
+    if (pad < 0 || pad >= numPads)
+    {
+        return;
+    }
+
+    padSamples[(size_t) pad].store(sample.get());
+
+    if (ownedSamples[(size_t) pad] != nullptr)
+    {
+        retired.push_back({ ownedSamples[(size_t) pad], renderCount.load() });
+    }
+
+    ownedSamples[(size_t) pad] = std::move(sample);
+    freeRetiredSamples();
+
+    if (!retired.empty())
+    {
+        startTimer(100);
+    }
+}
+
+void SamplePads::freeRetiredSamples()
+{
+    int64 count = renderCount.load();
+
+    // a sample retired between blocks is never read again. one retired mid block waits for that block to end
+    retired.erase(std::remove_if(retired.begin(), retired.end(), [count](const RetiredSample& r) { return r.renderCount % 2 == 0 || count > r.renderCount; }), retired.end());
+}
+
+void SamplePads::timerCallback()
+{
+    freeRetiredSamples();
+
+    if (retired.empty())
+    {
+        stopTimer();
+    }
+}
+
+File SamplePads::getSampleFile(int pad) const
+{
+    return pad >= 0 && pad < numPads && ownedSamples[(size_t) pad] != nullptr ? ownedSamples[(size_t) pad]->file : File();
+}
+
+void SamplePads::setLooping(int pad, bool shouldLoop)
+{
+    if (pad >= 0 && pad < numPads)
+    {
+        padLooping[(size_t) pad].store(shouldLoop);
+    }
+}
+
+bool SamplePads::isLooping(int pad) const
+{
+    return pad >= 0 && pad < numPads && padLooping[(size_t) pad].load();
+}
+
+void SamplePads::trigger(int pad, float velocity, int64 sampleTime)
+{
+    if (pad < 0 || pad >= numPads)
+    {
+        return;
+    }
+
+    // with the fifo full the trigger is dropped, that is dozens of hits inside one block
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        triggers[(size_t) start1] = { pad, velocity, sampleTime };
+        fifo.finishedWrite(1);
+    }
+}
+
+void SamplePads::triggerNow(int pad, float velocity)
+{
+    if (pad >= 0 && pad < numPads)
+    {
+        startVoice(pad, velocity, 0);
+    }
+}
+
+void SamplePads::setLevel(double newLevel)
+{
+    level.setTarget(jlimit(0.0, 1.0, newLevel));
+}
+
+double SamplePads::getLevel() const
+{
+    return level.getTarget();
+}
+
+int64 SamplePads::getSampleClock() const
+{
+    return sampleClock.load();
+}
+
+int SamplePads::getSoundingPads() const
+{
+    return soundingPads.load();
+}
+
+//==============================================================================
+void PadButton::clicked(const ModifierKeys& modifiers)
+{
+    if (onPress != nullptr)
+    {
+        onPress(modifiers.isPopupMenu());
+    }
+}
+
+//==============================================================================
+SamplePadsComponent::SamplePadsComponent(SamplePads& _pads, AudioFormatManager& _formatManager) : pads(_pads), formatManager(_formatManager)
+{
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        auto& button = padButtons[pad];
+
+        // pads play on the press, not the release, so they land where the finger does
+        button.setTriggeredOnMouseDown(true);
+        button.setClickingTogglesState(false);
+        button.setColour(TextButton::buttonOnColourId, Colours::orange);
+        button.onPress = [this, pad](bool isMenu)
+        {
+            if (isMenu)
+            {
+                showPadMenu(pad);
+            }
+            else
+            {
+                pads.trigger(pad);
+            }
+        };
+
+        updatePadText(pad);
+        addAndMakeVisible(button);
+    }
+
+    startTimer(50);
+}
+
+SamplePadsComponent::~SamplePadsComponent()
+{
+    stopTimer();
+    loadPool.removeAllJobs(true, 4000);
+}
+
+void SamplePadsComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
+}
+
+void SamplePadsComponent::resized()
+{
+    int numRows = (SamplePads::numPads + numColumns - 1) / numColumns;
+    int padW = getWidth() / numColumns;
+    int padH = getHeight() / numRows;
+
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        padButtons[pad].setBounds((pad % numColumns) * padW + 2, (pad / numColumns) * padH + 2, padW - 4, padH - 4);
+    }
+}
+
+bool SamplePadsComponent::isInterestedInFileDrag(const StringArray& files)
+{
+    return files.size() == 1;
+}
+
+void SamplePadsComponent::filesDropped(const StringArray& files, int x, int y)
+{
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        if (padButtons[pad].getBounds().contains(x, y))
+        {
+            loadPad(pad, File{ files[0] });
+            return;
+        }
+    }
+}
+
+void SamplePadsComponent::timerCallback()
+{
+    int sounding = pads.getSoundingPads();
+
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        padButtons[pad].setToggleState((sounding & (1 << pad)) != 0, dontSendNotification);
+    }
+}
+
+void SamplePadsComponent::showPadMenu(int pad)
+{
+    PopupMenu menu;
+    menu.addItem(1, "Load sample...");
+    menu.addItem(2, "Loop", pads.getSampleFile(pad) != File(), pads.isLooping(pad));
+    menu.addItem(3, "Clear", pads.getSampleFile(pad) != File());
+
+    Component::SafePointer<SamplePadsComponent> safeThis(this);
+
+    menu.showMenuAsync(PopupMenu::Options(), [safeThis, pad](int result)
+    {
+        if (safeThis == nullptr || result == 0)
+        {
+            return;
+        }
+
+        if (result == 1)
+        {
+            auto fileChooserFlags = FileBrowserComponent::canSelectFiles;
+            safeThis->fChooser.launchAsync(fileChooserFlags, [safeThis, pad](const FileChooser& chooser)
+            {
+                if (safeThis != nullptr && chooser.getResult() != File())
+                {
+                    safeThis->loadPad(pad, chooser.getResult());
+                }
+            });
+            return;
+        }
+
+        if (result == 2)
+        {
+            safeThis->pads.setLooping(pad, !safeThis->pads.isLooping(pad));
+        }
+        else
+        {
+            safeThis->pads.setSample(pad, nullptr);
+        }
+
+        safeThis->updatePadText(pad);
+
+        if (safeThis->onStateChanged != nullptr)
+        {
+            safeThis->onStateChanged();
+        }
+    });
+}
+
+void SamplePadsComponent::loadPad(int pad, const File& file, bool notify)
+{
+    Component::SafePointer<SamplePadsComponent> safeThis(this);
+    AudioFormatManager& manager = formatManager;
+
+    loadPool.addJob([safeThis, pad, file, notify, &manager]
+    {
+        auto sample = SamplePads::loadSample(manager, file);
+
+        MessageManager::callAsync([safeThis, pad, file, notify, sample]
+        {
+            if (safeThis == nullptr)
+            {
+                return;
+            }
+
+            // a file that could not be read, or is far too long for a pad, leaves the pad as it was
+            if (sample == nullptr)
+            {
+                std::cout << "SamplePadsComponent::loadPad could not use " << file.getFullPathName() << std::endl;
+                return;
+            }
+
+            safeThis->pads.setSample(pad, sample);
+            safeThis->updatePadText(pad);
+
+            if (notify && safeThis->onStateChanged != nullptr)
+            {
+                safeThis->onStateChanged();
+            }
+        });
+    });
+}
+
+void SamplePadsComponent::updatePadText(int pad)
+{
+    File file = pads.getSampleFile(pad);
+    String name = file != File() ? file.getFileNameWithoutExtension() : "Pad " + String(pad + 1);
+
+    padButtons[pad].setButtonText(pads.isLooping(pad) ? name + " (loop)" : name);
+}
+
+ValueTree SamplePadsComponent::getState() const
+{
+    ValueTree state{ "PADS" };
+
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        File file = pads.getSampleFile(pad);
+
+        if (file != File())
+        {
+            state.appendChild(ValueTree{ "PAD", { { "index", pad }, { "file", file.getFullPathName() }, { "loop", pads.isLooping(pad) } } }, nullptr);
+        }
+    }
+
+    return state;
+}
+
+void SamplePadsComponent::restoreState(const ValueTree& state)
+{
+    if (!state.hasType("PADS"))
+    {
+        return;
+    }
+
+    for (const auto& child : state)
+    {
+        int pad = child["index"];
+        File file{ child["file"].toString() };
+
+        // samples that have since been moved or deleted leave their pad empty
+        if (pad >= 0 && pad < SamplePads::numPads && file.existsAsFile())
+        {
+            // putting the session back does not write it out again
+            pads.setLooping(pad, child["loop"]);
+            loadPad(pad, file, false);
+        }
+    }
+}
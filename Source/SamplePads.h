@@ -0,0 +1,189 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DeckParameters.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/*
+    A bank of sample pads for one-shots and loops (airhorns, drops) played
+    alongside the decks. Samples are decoded into memory when they are put on
+    a pad, so a trigger never waits on the disk. Triggers are queued with the
+    sample clock time they should sound at and the audio thread starts them
+    on exactly that sample. The voices are a fixed set made up front, and
+    when every one is busy the oldest is taken over, so nothing is allocated
+    per trigger. A replaced sample is only freed once the audio thread can no
+    longer be playing it.
+*/
+class SamplePads : public AudioSource, private Timer
+{
+public:
+    static constexpr int numPads = 8;
+    static constexpr int numVoices = 16;
+
+    /** anything longer is a track, not a sample */
+    static constexpr double maxSampleSeconds = 30.0;
+
+    struct Sample
+    {
+        AudioBuffer<float> audio;
+        double sampleRate = 0.0;
+        File file;
+    };
+
+    SamplePads();
+    ~SamplePads() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /** decodes a whole file into memory. safe from any thread. nullptr if it cannot be read or is too long */
+    static std::shared_ptr<Sample> loadSample(AudioFormatManager& formatManager, const File& file);
+
+    /** message thread: puts a sample on a pad, nullptr to clear it. voices still playing the old one stop */
+    void setSample(int pad, std::shared_ptr<Sample> sample);
+    File getSampleFile(int pad) const;
+
+    /** a looping pad plays until it is triggered again, a one-shot plays to its end */
+    void setLooping(int pad, bool shouldLoop);
+    bool isLooping(int pad) const;
+
+    /** message thread: plays a pad at a velocity of 0-1, starting on the given sample clock time. a time
+        that has already gone, or -1, starts it at the beginning of the next block */
+    void trigger(int pad, float velocity = 1.0f, int64 sampleTime = -1);
+
+    /** audio thread: plays a pad from the start of the block about to be rendered. used by the MIDI controller */
+    void triggerNow(int pad, float velocity);
+
+    /** level of the whole bank into the master, 0-1 */
+    void setLevel(double level);
+    double getLevel() const;
+
+    /** number of samples rendered so far. advances on the audio thread */
+    int64 getSampleClock() const;
+
+    /** one bit for each pad that is sounding, for the GUI */
+    int getSoundingPads() const;
+
+private:
+    struct Trigger
+    {
+        int pad;
+        float velocity;
+        int64 sampleTime;
+    };
+
+    struct Voice
+    {
+        const Sample* sample = nullptr; // nullptr when the voice is free
+        int pad = -1;
+        double position = 0.0;
+        float gain = 1.0f;
+        int delay = 0;          // silent samples before it starts, for a trigger part way into a block
+        int release = -1;       // samples left of the fade out, -1 while not releasing
+        int64 startedAt = 0;
+    };
+
+    static constexpr int fifoSize = 64;
+    static constexpr int releaseSamples = 256;
+
+    void timerCallback() override;
+
+    /** audio thread: starts a voice, or releases a looping pad that is already playing */
+    void startVoice(int pad, float velocity, int delay);
+    void renderVoice(Voice& voice, AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void freeRetiredSamples();
+
+    // what the audio thread plays for each pad. the message thread owns the samples themselves
+    std::array<std::atomic<const Sample*>, numPads> padSamples;
+    std::array<std::atomic<bool>, numPads> padLooping;
+    std::array<std::shared_ptr<Sample>, numPads> ownedSamples;
+
+    // samples taken off a pad, kept until the audio thread has moved on. renderCount is odd during a block
+    struct RetiredSample
+    {
+        std::shared_ptr<Sample> sample;
+        int64 renderCount;
+    };
+
+    std::vector<RetiredSample> retired;
+    std::atomic<int64> renderCount{ 0 };
+
+    // triggers from the message thread. the audio thread moves them into scheduled until they are due
+    AbstractFifo fifo{ fifoSize };
+    std::array<Trigger, fifoSize> triggers;
+    std::array<Trigger, fifoSize> scheduled;
+    int numScheduled = 0;
+
+    // audio thread only
+    std::array<Voice, numVoices> voices;
+    double outputRate = 44100.0;
+
+    SmoothedParameter level{ 1.0, 0.05 };
+    std::atomic<int64> sampleClock{ 0 };
+    std::atomic<int> soundingPads{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePads)
+};
+
+//==============================================================================
+/*
+    One pad in the bank. A left click plays it, a right click opens its menu.
+*/
+class PadButton : public TextButton
+{
+public:
+    std::function<void(bool isMenu)> onPress;
+
+    void clicked(const ModifierKeys& modifiers) override;
+};
+
+//==============================================================================
+/*
+    The pad grid. Samples are put on a pad from its menu or by dropping a file
+    on it, and are decoded on a background thread.
+*/
+class SamplePadsComponent : public juce::Component, public FileDragAndDropTarget, public Timer
+{
+public:
+    SamplePadsComponent(SamplePads& _pads, AudioFormatManager& _formatManager);
+    ~SamplePadsComponent() override;
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+
+    bool isInterestedInFileDrag(const StringArray& files) override;
+    void filesDropped(const StringArray& files, int x, int y) override;
+
+    /** lights the pads that are sounding */
+    void timerCallback() override;
+
+    /** which sample is on each pad and whether it loops, for the session */
+    ValueTree getState() const;
+    void restoreState(const ValueTree& state);
+
+    /** called whenever a pad changes */
+    std::function<void()> onStateChanged;
+
+private:
+    static constexpr int numColumns = 4;
+
+    void showPadMenu(int pad);
+    void loadPad(int pad, const File& file, bool notify = true);
+    void updatePadText(int pad);
+
+    SamplePads& pads;
+    AudioFormatManager& formatManager;
+
+    PadButton padButtons[SamplePads::numPads];
+    FileChooser fChooser{ "Select a sample..." };
+
+    // samples are decoded here, off the message thread
+    ThreadPool loadPool{ 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePadsComponent)
+};
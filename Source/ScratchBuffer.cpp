@@ -0,0 +1,260 @@
+#include "ScratchBuffer.h"
+#include <cmath>
+
+//==============================================================================
+ScratchBuffer::ScratchBuffer(int _maxPairs, int _capacity) : maxPairs(jlimit(1, maxStemPairs, _maxPairs)), capacity(_capacity), guard(_capacity / 8), ring(maxPairs * 2, capacity)
+{
+    jassert(isPowerOfTwo(capacity) && capacity >= chunkSize * 8);
+    ring.clear();
+
+    // windowed sinc with a = 4, taps run from 3 before the read position to 4 after it
+    auto sinc = [](double x) { return x == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * x) / (MathConstants<double>::pi * x); };
+
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        double frac = (double) phase / numPhases;
+        double sum = 0.0;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            double x = (tap - 3) - frac;
+            double weight = std::abs(x) < 4.0 ? sinc(x) * sinc(x / 4.0) : 0.0;
+            kernel[(size_t) phase][(size_t) tap] = (float) weight;
+            sum += weight;
+        }
+
+        // normalised so a constant signal comes out at the same level at every phase
+        for (auto& weight : kernel[(size_t) phase])
+        {
+            weight = (float) (weight / sum);
+        }
+    }
+}
+
+ScratchBuffer::~ScratchBuffer()
+{
+}
+
+void ScratchBuffer::setReader(AudioFormatReader* newReader, int numStems)
+{
+    const ScopedLock sl(readerLock);
+
+    // the old samples stay in the ring and keep playing until the audio thread takes the new reader
+    reader.reset(newReader);
+
+    nextLength.store(reader != nullptr ? reader->lengthInSamples : 0);
+    nextSampleRate.store(reader != nullptr ? reader->sampleRate : 0.0);
+    nextNumPairs.store(jlimit(1, maxPairs, numStems));
+    ++requestedGeneration;
+}
+
+void ScratchBuffer::startBlock()
+{
+    int requested = requestedGeneration.load();
+
+    if (requested == activeGeneration.load())
+    {
+        return;
+    }
+
+    // nothing of the old track is played from here on, so the decoder is free to overwrite it
+    validStart.store(0);
+    validEnd.store(0);
+    lengthInSamples.store(nextLength.load());
+    sampleRate.store(nextSampleRate.load());
+    numPairs.store(nextNumPairs.load());
+    activeGeneration.store(requested);
+}
+
+bool ScratchBuffer::hasPendingReader() const
+{
+    return requestedGeneration.load() != activeGeneration.load();
+}
+
+void ScratchBuffer::setFilling(bool shouldFill)
+{
+    filling.store(shouldFill);
+}
+
+double ScratchBuffer::getSampleRate() const
+{
+    return sampleRate.load();
+}
+
+int64 ScratchBuffer::getLengthInSamples() const
+{
+    return lengthInSamples.load();
+}
+
+void ScratchBuffer::setPlayhead(double position)
+{
+    playhead.store(position);
+}
+
+bool ScratchBuffer::isReady(double position, int numSamples) const
+{
+    auto first = (int64) std::floor(position) - 3;
+    return first >= validStart.load() && first + numSamples + numTaps <= validEnd.load();
+}
+
+void ScratchBuffer::render(AudioBuffer<float>& buffer, int startSample, int numSamples, double& position, double startStep, double endStep,
+                           const float* startGains, const float* endGains) const
+{
+    int64 start = validStart.load();
+    int64 end = validEnd.load();
+    int pairs = numPairs.load();
+    const int mask = capacity - 1;
+
+    float gain[maxStemPairs];
+    float gainChange[maxStemPairs];
+
+    for (int pair = 0; pair < pairs; ++pair)
+    {
+        gain[pair] = startGains != nullptr ? startGains[pair] : 1.0f;
+        gainChange[pair] = startGains != nullptr && numSamples > 0 ? (endGains[pair] - startGains[pair]) / numSamples : 0.0f;
+    }
+
+    float* outLeft = buffer.getWritePointer(0, startSample);
+    float* outRight = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1, startSample) : nullptr;
+
+    double step = startStep;
+    double stepChange = numSamples > 0 ? (endStep - startStep) / numSamples : 0.0;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto index = (int64) std::floor(position);
+        float l = 0.0f;
+        float r = 0.0f;
+
+        // a sample the decoder has not reached yet plays as silence rather than stalling the block
+        if (index - 3 >= start && index + 5 <= end)
+        {
+            auto& taps = kernel[(size_t) ((position - (double) index) * numPhases)];
+
+            for (int pair = 0; pair < pairs; ++pair)
+            {
+                // a muted stem is skipped rather than interpolated and thrown away
+                if (gain[pair] == 0.0f && gainChange[pair] == 0.0f)
+                {
+                    continue;
+                }
+
+                const float* left = ring.getReadPointer(pair * 2);
+                const float* right = ring.getReadPointer(pair * 2 + 1);
+                float pairLeft = 0.0f;
+                float pairRight = 0.0f;
+
+                for (int tap = 0; tap < numTaps; ++tap)
+                {
+                    int slot = (int) ((index - 3 + tap) & mask);
+                    pairLeft += left[slot] * taps[(size_t) tap];
+                    pairRight += right[slot] * taps[(size_t) tap];
+                }
+
+                l += pairLeft * gain[pair];
+                r += pairRight * gain[pair];
+            }
+        }
+
+        for (int pair = 0; pair < pairs; ++pair)
+        {
+            gain[pair] += gainChange[pair];
+        }
+
+        outLeft[i] = l;
+        if (outRight != nullptr)
+        {
+            outRight[i] = r;
+        }
+
+        // the record stops at the start, it does not wrap
+        position = jmax(0.0, position + step);
+        step += stepChange;
+    }
+}
+
+void ScratchBuffer::fill(int64 from, int numSamples)
+{
+    // split where the ring wraps
+    int slot = (int) (from & (capacity - 1));
+    int firstPart = jmin(numSamples, capacity - slot);
+
+    // only the channels this track uses are decoded into, the rest of the ring is left alone
+    AudioBuffer<float> used(ring.getArrayOfWritePointers(), numPairs.load() * 2, capacity);
+
+    reader->read(&used, slot, firstPart, from, true, true);
+
+    if (firstPart < numSamples)
+    {
+        reader->read(&used, 0, numSamples - firstPart, from + firstPart, true, true);
+    }
+}
+
+int ScratchBuffer::useTimeSlice()
+{
+    const ScopedLock sl(readerLock);
+
+    if (reader == nullptr || !filling.load())
+    {
+        return 100;
+    }
+
+    // a new reader waits for the audio thread to let go of the old samples, which is at most a block away
+    if (hasPendingReader())
+    {
+        return 1;
+    }
+
+    auto centre = (int64) playhead.load();
+    int64 length = lengthInSamples.load();
+    int64 start = validStart.load();
+    int64 end = validEnd.load();
+
+    const int64 reach = capacity / 2 - guard;
+    int64 wantStart = jmax((int64) 0, centre - reach);
+    int64 wantEnd = jmin(length, centre + reach);
+
+    // a jump away from what is decoded starts the ring again at the playhead
+    if (centre < start - chunkSize || centre > end + chunkSize)
+    {
+        validEnd.store(start);
+        validStart.store(jlimit((int64) 0, length, centre));
+        validEnd.store(validStart.load());
+        return 0;
+    }
+
+    // whichever side of the playhead has less decoded is filled first, so reversing is as safe as playing on
+    bool forwardWanted = end < wantEnd;
+    bool backwardWanted = start > wantStart;
+
+    if (forwardWanted && (!backwardWanted || end - centre <= centre - start))
+    {
+        int n = (int) jmin((int64) chunkSize, wantEnd - end);
+
+        // the oldest samples behind go first, they are never within the guard of the playhead
+        if (end + n - start > capacity)
+        {
+            validStart.store(end + n - capacity);
+        }
+
+        fill(end, n);
+        validEnd.store(end + n);
+        return 0;
+    }
+
+    if (backwardWanted)
+    {
+        int n = (int) jmin((int64) chunkSize, start - wantStart);
+
+        if (end - (start - n) > capacity)
+        {
+            validEnd.store(start - n + capacity);
+        }
+
+        fill(start - n, n);
+        validStart.store(start - n);
+        return 0;
+    }
+
+    return 20;
+}
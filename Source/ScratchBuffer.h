@@ -0,0 +1,100 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+
+//==============================================================================
+/*
+    A few seconds of decoded audio either side of a deck's playhead, kept in a
+    ring by the deck's read-ahead thread. Vinyl mode plays from here, at any
+    rate and in either direction, so scratching never waits on the decoder:
+    the audio thread only reads samples that are already in the ring and
+    plays silence for any it has outrun. A stem track keeps a stereo pair per
+    stem, mixed with the stem gains as it is rendered.
+*/
+class ScratchBuffer : public TimeSliceClient
+{
+public:
+    /** room for the given number of stereo pairs, each holding capacity samples, a power of two. a deck
+        needs a pair per stem and room to scratch either way, a library preview one pair playing forwards */
+    ScratchBuffer(int _maxPairs = maxStemPairs, int _capacity = 1 << 19);
+    ~ScratchBuffer() override;
+
+    /** message thread: decodes from this reader from now on. takes ownership, nullptr to unload.
+        a stem reader gives numStems stereo pairs, anything else is read as one. the audio thread
+        switches over at its next startBlock, nothing is decoded for the new reader before then */
+    void setReader(AudioFormatReader* newReader, int numStems = 0);
+
+    /** audio thread: called before anything else in a block. picks up a reader set since the last one */
+    void startBlock();
+
+    /** audio thread: true when a reader was set after this block's startBlock, and is waiting for the next */
+    bool hasPendingReader() const;
+
+    /** the ring is only kept filled while this is on */
+    void setFilling(bool shouldFill);
+
+    double getSampleRate() const;
+    int64 getLengthInSamples() const;
+
+    /** audio thread: where the deck is, in source samples. the ring is kept centred here */
+    void setPlayhead(double position);
+
+    /** audio thread: true when the samples from position onwards are already decoded */
+    bool isReady(double position, int numSamples) const;
+
+    /** audio thread: renders numSamples starting at position, stepping from startStep to endStep
+        source samples per output sample, and moves position on to where it stopped. with stems, each
+        pair is ramped from startGains to endGains across the block, or summed at full level without them */
+    void render(AudioBuffer<float>& buffer, int startSample, int numSamples, double& position, double startStep, double endStep,
+                const float* startGains = nullptr, const float* endGains = nullptr) const;
+
+    int useTimeSlice() override;
+
+    // room for a stereo pair per stem, so loading a stem track never reallocates under the audio thread
+    static constexpr int maxStemPairs = 4;
+
+private:
+    static constexpr int chunkSize = 8192;
+
+    const int maxPairs;
+    const int capacity;
+
+    // samples this close to the playhead are never evicted. an eighth of the ring covers a block played at the fastest step
+    const int guard;
+
+    // 8 tap Lanczos kernel, tabulated for this many fractional positions
+    static constexpr int numTaps = 8;
+    static constexpr int numPhases = 512;
+
+    void fill(int64 from, int numSamples);
+
+    AudioBuffer<float> ring;
+    std::array<std::array<float, numTaps>, numPhases + 1> kernel;
+
+    // decoded samples are [validStart, validEnd), both in source samples
+    std::atomic<int64> validStart{ 0 };
+    std::atomic<int64> validEnd{ 0 };
+    std::atomic<double> playhead{ 0.0 };
+    std::atomic<int64> lengthInSamples{ 0 };
+    std::atomic<double> sampleRate{ 0.0 };
+    std::atomic<int> numPairs{ 1 };
+    std::atomic<bool> filling{ false };
+
+    // a new reader is described here and published by bumping requestedGeneration. the audio thread copies
+    // it into the values above at a block boundary and only then sets activeGeneration, so the decoder never
+    // writes the new track into slots a block still in progress is reading
+    std::atomic<int64> nextLength{ 0 };
+    std::atomic<double> nextSampleRate{ 0.0 };
+    std::atomic<int> nextNumPairs{ 1 };
+    std::atomic<int> requestedGeneration{ 0 };
+    std::atomic<int> activeGeneration{ 0 };
+
+    // held by the read-ahead thread while it decodes, never by the audio thread
+    CriticalSection readerLock;
+    std::unique_ptr<AudioFormatReader> reader;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScratchBuffer)
+};
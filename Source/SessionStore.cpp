@@ -0,0 +1,199 @@
+#include "SessionStore.h"
+
+namespace
+{
+    // "OTOS" followed by a format version, in front of each section
+    const int sessionMagic = 0x534f544f;
+    const int sessionVersion = 1;
+
+    // changes arriving within this long of each other end up in one write
+    const int writeDelayMs = 500;
+
+    const char* sectionNames[] = { "library", "deck1", "deck2", "midi", "pads" };
+
+    MemoryBlock serialise(const ValueTree& state)
+    {
+        MemoryBlock data;
+        MemoryOutputStream out(data, false);
+        out.writeInt(sessionMagic);
+        out.writeInt(sessionVersion);
+        state.writeToStream(out);
+        out.flush();
+
+        return data;
+    }
+}
+
+//==============================================================================
+SessionStore::SessionStore(const File& _sessionFolder) : Thread("Session Writer"), sessionFolder(_sessionFolder)
+{
+    startThread();
+}
+
+SessionStore::~SessionStore()
+{
+    stopThread(2000);
+    flush();
+}
+
+File SessionStore::getDefaultSessionFolder()
+{
+    return File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("OtoDecks").getChildFile("Session");
+}
+
+File SessionStore::getSectionFile(Section section) const
+{
+    return sessionFolder.getChildFile(String(sectionNames[section]) + ".session");
+}
+
+std::array<ValueTree, SessionStore::numSections> SessionStore::restore() const
+{
+    std::array<ValueTree, numSections> sections;
+
+    for (int s = 0; s < numSections; ++s)
+    {
+        MemoryBlock data;
+        if (!getSectionFile((Section) s).loadFileAsData(data) || data.getSize() < 8)
+        {
+            continue;
+        }
+
+        MemoryInputStream in(data, false);
+
+        // a file from another version is ignored rather than half read
+        if (in.readInt() != sessionMagic || in.readInt() != sessionVersion)
+        {
+            continue;
+        }
+
+        sections[s] = ValueTree::readFromData(addBytesToPointer(data.getData(), 8), data.getSize() - 8);
+    }
+
+    return sections;
+}
+
+void SessionStore::update(Section section, const ValueTree& state)
+{
+    // only the section that changed is serialised, the others keep what they already have on disk
+    MemoryBlock data = serialise(state);
+
+    {
+        const ScopedLock sl(pendingLock);
+        pending[section] = std::move(data);
+        pendingBuilders[section] = nullptr;
+        isPending[section] = true;
+    }
+
+    notify();
+}
+
+void SessionStore::update(Section section, std::function<ValueTree()> makeState)
+{
+    // a newer change replaces the older one before it was ever built
+    {
+        const ScopedLock sl(pendingLock);
+        pending[section].reset();
+        pendingBuilders[section] = std::move(makeState);
+        isPending[section] = true;
+    }
+
+    notify();
+}
+
+bool SessionStore::flush()
+{
+    const ScopedLock writeSl(writeLock);
+    bool ok = true;
+
+    for (int s = 0; s < numSections; ++s)
+    {
+        MemoryBlock data;
+        std::function<ValueTree()> makeState;
+        {
+            const ScopedLock sl(pendingLock);
+
+            if (!isPending[s])
+            {
+                continue;
+            }
+
+            data.swapWith(pending[s]);
+            makeState = std::move(pendingBuilders[s]);
+            pendingBuilders[s] = nullptr;
+            isPending[s] = false;
+        }
+
+        if (makeState != nullptr)
+        {
+            data = serialise(makeState());
+        }
+
+        if (!writeSection((Section) s, data))
+        {
+            // kept for the next attempt, unless a newer copy arrived meanwhile
+            const ScopedLock sl(pendingLock);
+
+            if (!isPending[s])
+            {
+                pending[s] = std::move(data);
+                isPending[s] = true;
+            }
+
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+bool SessionStore::writeSection(Section section, const MemoryBlock& data) const
+{
+    if (!sessionFolder.createDirectory())
+    {
+        return false;
+    }
+
+    // written next to the target and renamed over it, so the file is either the old copy or the new one
+    File target = getSectionFile(section);
+    TemporaryFile temp(target);
+
+    {
+        FileOutputStream out(temp.getFile());
+
+        if (!out.openedOk() || !out.write(data.getData(), data.getSize()))
+        {
+            return false;
+        }
+
+        out.flush();
+
+        if (out.getStatus().failed())
+        {
+            return false;
+        }
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+void SessionStore::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        if (threadShouldExit())
+        {
+            return;
+        }
+
+        // slider drags and a playing deck update often, so changes are gathered for a moment first. slept
+        // out in slices rather than waited on, as every further change would notify and cut the wait short
+        for (int slept = 0; slept < writeDelayMs && !threadShouldExit(); slept += 50)
+        {
+            Thread::sleep(50);
+        }
+
+        flush();
+    }
+}
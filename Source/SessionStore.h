@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <functional>
+
+//==============================================================================
+/*
+    Keeps the session on disk: the library and the state of each deck. Each
+    section lives in its own file and is only serialised again when it
+    changes, so a deck moving along does not rewrite a large library. Files
+    are written on a background thread and swapped in atomically, so a crash
+    mid-write leaves the previous copy intact. A large section can be handed
+    over as a function that builds it, so even its tree is made on the writer
+    thread.
+*/
+class SessionStore : private Thread
+{
+public:
+    enum Section
+    {
+        library,
+        deck1,
+        deck2,
+        midi,
+        pads,
+        numSections
+    };
+
+    SessionStore(const File& _sessionFolder);
+    ~SessionStore() override;
+
+    /** where the app keeps its session between launches */
+    static File getDefaultSessionFolder();
+
+    /** reads every section. sections that are missing or damaged come back invalid */
+    std::array<ValueTree, numSections> restore() const;
+
+    /** message thread: replaces one section. the file is written a moment later in the background */
+    void update(Section section, const ValueTree& state);
+
+    /** message thread: replaces one section with one built by makeState when it is written, on whichever
+        thread writes it. makeState must only use what it has captured */
+    void update(Section section, std::function<ValueTree()> makeState);
+
+    /** writes whatever is still pending on the calling thread. returns false if a write failed */
+    bool flush();
+
+private:
+    void run() override;
+
+    File getSectionFile(Section section) const;
+    bool writeSection(Section section, const MemoryBlock& data) const;
+
+    File sessionFolder;
+
+    // sections waiting to be written, either serialised already or still to be built. guarded by pendingLock
+    CriticalSection pendingLock;
+    std::array<MemoryBlock, numSections> pending;
+    std::array<std::function<ValueTree()>, numSections> pendingBuilders;
+    std::array<bool, numSections> isPending{};
+
+    // the background thread and flush never write at the same time
+    CriticalSection writeLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SessionStore)
+};
@@ -0,0 +1,115 @@
+#include "StemReader.h"
+
+//==============================================================================
+StemReader::StemReader(std::vector<std::unique_ptr<AudioFormatReader>> _sources, int _stemsPerSource) : AudioFormatReader(nullptr, "Stems"), sources(std::move(_sources)), stemsPerSource(_stemsPerSource)
+{
+    for (auto& source : sources)
+    {
+        if (source != nullptr)
+        {
+            // the first stem sets the rate, the longest sets the length
+            if (sampleRate == 0.0)
+            {
+                sampleRate = source->sampleRate;
+            }
+
+            lengthInSamples = jmax(lengthInSamples, source->lengthInSamples);
+        }
+    }
+
+    numChannels = (unsigned int) (numStems * 2);
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+}
+
+String StemReader::getStemName(int stem)
+{
+    static const char* const names[] = { "vocals", "drums", "bass", "other" };
+    return stem >= 0 && stem < numStems ? names[stem] : "";
+}
+
+StemReader* StemReader::create(AudioFormatManager& formatManager, const File& track)
+{
+    std::vector<std::unique_ptr<AudioFormatReader>> sources;
+
+    // a container holds every stem in the one file
+    std::unique_ptr<AudioFormatReader> trackReader(formatManager.createReaderFor(track));
+
+    if (trackReader != nullptr && trackReader->numChannels == numStems * 2)
+    {
+        sources.push_back(std::move(trackReader));
+        return new StemReader(std::move(sources), numStems);
+    }
+
+    // otherwise each stem is looked for beside the track, in any format there is a decoder for
+    int found = 0;
+    double sampleRate = 0.0;
+
+    for (int stem = 0; stem < numStems; ++stem)
+    {
+        std::unique_ptr<AudioFormatReader> stemReader;
+        String pattern = track.getFileNameWithoutExtension() + "." + getStemName(stem) + ".*";
+
+        for (const auto& entry : RangedDirectoryIterator(track.getParentDirectory(), false, pattern, File::findFiles))
+        {
+            stemReader.reset(formatManager.createReaderFor(entry.getFile()));
+
+            // stems are read sample for sample, so one at a different rate would drift. it counts as missing
+            if (stemReader != nullptr && sampleRate > 0.0 && stemReader->sampleRate != sampleRate)
+            {
+                stemReader.reset();
+                continue;
+            }
+
+            if (stemReader != nullptr)
+            {
+                sampleRate = stemReader->sampleRate;
+                ++found;
+                break;
+            }
+        }
+
+        sources.push_back(std::move(stemReader));
+    }
+
+    return found >= 2 ? new StemReader(std::move(sources), 1) : nullptr;
+}
+
+bool StemReader::readSamples(int** destSamples, int numDestChannels, int startOffsetInDestBuffer, int64 startSampleInFile, int numSamples)
+{
+    // usesFloatingPointData is set, so the destination really holds floats
+    for (int ch = 0; ch < numDestChannels; ++ch)
+    {
+        if (destSamples[ch] != nullptr)
+        {
+            FloatVectorOperations::clear(reinterpret_cast<float*>(destSamples[ch]) + startOffsetInDestBuffer, numSamples);
+        }
+    }
+
+    int channelsPerSource = stemsPerSource * 2;
+    sourceBuffer.setSize(channelsPerSource, numSamples, false, false, true);
+
+    for (size_t s = 0; s < sources.size(); ++s)
+    {
+        // a missing stem is left silent
+        if (sources[s] == nullptr)
+        {
+            continue;
+        }
+
+        // mono stems come back with the channel copied into both sides
+        sources[s]->read(sourceBuffer.getArrayOfWritePointers(), channelsPerSource, startSampleInFile, numSamples);
+
+        for (int c = 0; c < channelsPerSource; ++c)
+        {
+            int outChannel = ((int) s * stemsPerSource + c / 2) * 2 + c % 2;
+
+            if (outChannel < numDestChannels && destSamples[outChannel] != nullptr)
+            {
+                FloatVectorOperations::add(reinterpret_cast<float*>(destSamples[outChannel]) + startOffsetInDestBuffer, sourceBuffer.getReadPointer(c), numSamples);
+            }
+        }
+    }
+
+    return true;
+}
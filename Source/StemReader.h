@@ -0,0 +1,40 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/*
+    Reads the stems of a track as one multichannel stream, so a deck can play
+    them all through the same read-ahead, position and resampler. Stems come
+    either from files beside the track, named after it (Track.vocals.wav,
+    Track.drums.flac and so on), or from a single container file holding a
+    stereo pair per stem in the order vocals, drums, bass, other. Each stem
+    gets a pair of output channels. Samples are always delivered as floats.
+*/
+class StemReader : public AudioFormatReader
+{
+public:
+    enum Stem { vocals = 0, drums, bass, other, numStems };
+
+    static String getStemName(int stem);
+
+    /** a reader for the stems of a track, or nullptr if it has none. needs at least two stems to be found.
+        missing stems are read as silence */
+    static StemReader* create(AudioFormatManager& formatManager, const File& track);
+
+    bool readSamples(int** destSamples, int numDestChannels, int startOffsetInDestBuffer, int64 startSampleInFile, int numSamples) override;
+
+private:
+    StemReader(std::vector<std::unique_ptr<AudioFormatReader>> _sources, int _stemsPerSource);
+
+    // one reader per stem file, or a single reader for a container. an empty slot is a missing stem
+    std::vector<std::unique_ptr<AudioFormatReader>> sources;
+    int stemsPerSource;
+
+    // each source is read in here before being copied into place
+    AudioBuffer<float> sourceBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemReader)
+};
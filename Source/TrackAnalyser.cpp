@@ -0,0 +1,526 @@
+#include "TrackAnalyser.h"
+#include "HarmonicIndex.h"
+#include <array>
+#include <cmath>
+#include <numeric>
+
+//==============================================================================
+int TrackAnalysis::getNumColumns() const
+{
+    return (int) bandLevels.size() / numBands;
+}
+
+float TrackAnalysis::getLevel(int column, Band band) const
+{
+    return bandLevels[(size_t) (column * numBands + band)] / 255.0f;
+}
+
+double TrackAnalysis::samplesToSeconds(int64 samples) const
+{
+    return sampleRate > 0.0 ? samples / sampleRate : 0.0;
+}
+
+//==============================================================================
+class TrackAnalyser::AnalysisJob : public ThreadPoolJob
+{
+public:
+    AnalysisJob(TrackAnalyser& _owner, const File& _file, int _generation) : ThreadPoolJob("Track Analysis"), owner(_owner), file(_file), generation(_generation)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        std::shared_ptr<const TrackAnalysis> result;
+
+        if (auto reader = owner.metadataService.takeReader(file))
+        {
+            result = TrackAnalyser::analyse(*reader, [this] {return shouldExit();});
+            owner.metadataService.returnReader(file, std::move(reader));
+        }
+
+        if (shouldExit())
+        {
+            return jobHasFinished;
+        }
+
+        std::vector<Callback> callbacks;
+        {
+            const ScopedLock sl(owner.cacheLock);
+            auto it = owner.inFlight.find(file.getFullPathName());
+
+            // the file changed while this job was reading it. a newer job has its callbacks and will answer them
+            if (it == owner.inFlight.end() || it->second->generation != generation)
+            {
+                return jobHasFinished;
+            }
+
+            callbacks.swap(it->second->callbacks);
+            owner.inFlight.erase(it);
+
+            if (result != nullptr)
+            {
+                owner.storeResult(file, result);
+            }
+        }
+
+        MessageManager::callAsync([callbacks, result]
+        {
+            for (auto& cb : callbacks)
+            {
+                cb(result);
+            }
+        });
+
+        return jobHasFinished;
+    }
+
+private:
+    TrackAnalyser& owner;
+    File file;
+    int generation;
+};
+
+//==============================================================================
+TrackAnalyser::TrackAnalyser(TrackMetadataService& _metadataService) : metadataService(_metadataService)
+{
+}
+
+TrackAnalyser::~TrackAnalyser()
+{
+    pool.removeAllJobs(true, 4000);
+}
+
+void TrackAnalyser::requestAnalysis(const File& file, Callback callback)
+{
+    if (auto cached = getCachedAnalysis(file))
+    {
+        callback(cached);
+        return;
+    }
+
+    const ScopedLock sl(cacheLock);
+    auto it = inFlight.find(file.getFullPathName());
+
+    if (it != inFlight.end())
+    {
+        it->second->callbacks.push_back(std::move(callback));
+        return;
+    }
+
+    std::vector<Callback> callbacks;
+    callbacks.push_back(std::move(callback));
+    startRequest(file, std::move(callbacks));
+}
+
+void TrackAnalyser::startRequest(const File& file, std::vector<Callback> callbacks)
+{
+    auto request = std::make_shared<Request>();
+    request->generation = ++lastGeneration;
+    request->callbacks = std::move(callbacks);
+
+    inFlight[file.getFullPathName()] = request;
+    pool.addJob(new AnalysisJob(*this, file, request->generation), true);
+}
+
+std::shared_ptr<const TrackAnalysis> TrackAnalyser::getCachedAnalysis(const File& file) const
+{
+    const ScopedLock sl(cacheLock);
+
+    auto it = cacheIndex.find(file.getFullPathName());
+    if (it == cacheIndex.end())
+    {
+        return nullptr;
+    }
+
+    cache.splice(cache.begin(), cache, it->second);
+    return it->second->second;
+}
+
+void TrackAnalyser::invalidate(const File& file)
+{
+    const ScopedLock sl(cacheLock);
+
+    auto it = cacheIndex.find(file.getFullPathName());
+    if (it != cacheIndex.end())
+    {
+        cache.erase(it->second);
+        cacheIndex.erase(it);
+    }
+
+    // a job already reading the old contents is superseded. whoever was waiting on it waits on a fresh job instead
+    auto request = inFlight.find(file.getFullPathName());
+    if (request != inFlight.end())
+    {
+        std::vector<Callback> callbacks;
+        callbacks.swap(request->second->callbacks);
+        startRequest(file, std::move(callbacks));
+    }
+}
+
+void TrackAnalyser::storeResult(const File& file, std::shared_ptr<const TrackAnalysis> analysis)
+{
+    const ScopedLock sl(cacheLock);
+    String path = file.getFullPathName();
+
+    auto it = cacheIndex.find(path);
+    if (it != cacheIndex.end())
+    {
+        cache.erase(it->second);
+    }
+
+    cache.emplace_front(path, analysis);
+    cacheIndex[path] = cache.begin();
+
+    // the least recently used result goes first
+    if (cache.size() > maxCachedAnalyses)
+    {
+        cacheIndex.erase(cache.back().first);
+        cache.pop_back();
+    }
+}
+
+std::shared_ptr<TrackAnalysis> TrackAnalyser::analyse(AudioFormatReader& reader, std::function<bool()> shouldExit)
+{
+    const int fftOrder = 11;
+    const int fftSize = 1 << fftOrder;
+
+    // about 5Hz per bin at 44.1kHz, fine enough to tell semitones apart down to 100Hz
+    const int keyFftOrder = fftOrder + 2;
+    const int keyFftSize = 1 << keyFftOrder;
+    const int framesPerKeyFrame = keyFftSize / fftSize;
+
+    if (reader.lengthInSamples <= 0 || reader.sampleRate <= 0 || reader.numChannels == 0)
+    {
+        return nullptr;
+    }
+
+    dsp::FFT fft(fftOrder);
+    dsp::WindowingFunction<float> window((size_t) fftSize, dsp::WindowingFunction<float>::hann);
+
+    dsp::FFT keyFft(keyFftOrder);
+    dsp::WindowingFunction<float> keyWindow((size_t) keyFftSize, dsp::WindowingFunction<float>::hann);
+
+    // band edges as FFT bins: lows up to 250Hz, mids up to 4kHz, highs above
+    double binHz = reader.sampleRate / fftSize;
+    int lowEnd = jlimit(1, fftSize / 2, (int) (250.0 / binHz));
+    int midEnd = jlimit(lowEnd, fftSize / 2, (int) (4000.0 / binHz));
+
+    int64 numFrames = (reader.lengthInSamples + fftSize - 1) / fftSize;
+    int columns = (int) jmin((int64) numColumns, numFrames);
+
+    std::vector<double> energy((size_t) (columns * TrackAnalysis::numBands), 0.0);
+    std::vector<int> framesPerColumn((size_t) columns, 0);
+
+    AudioBuffer<float> block((int) jmin(2u, reader.numChannels), fftSize);
+    std::vector<float> fftData((size_t) fftSize * 2);
+    std::vector<float> frameEnergy((size_t) numFrames, 0.0f);
+
+    // the mono mix of the last few frames, and the key FFT's magnitudes summed over the track
+    std::vector<float> keyInput((size_t) keyFftSize, 0.0f);
+    std::vector<float> keyData((size_t) keyFftSize * 2);
+    std::vector<float> keySpectrum((size_t) keyFftSize / 2, 0.0f);
+
+    int64 firstAudible = -1;
+    int64 lastAudible = -1;
+
+    for (int64 frame = 0; frame < numFrames; ++frame)
+    {
+        if (shouldExit())
+        {
+            return nullptr;
+        }
+
+        int64 pos = frame * fftSize;
+        reader.read(&block, 0, fftSize, pos, true, true);
+
+        // silence is checked on the whole frame first, only loud frames are searched sample by sample
+        float framePeak = 0.0f;
+        float frameRms = 0.0f;
+
+        for (int ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto range = FloatVectorOperations::findMinAndMax(block.getReadPointer(ch), fftSize);
+            framePeak = jmax(framePeak, std::abs(range.getStart()), std::abs(range.getEnd()));
+            frameRms += block.getRMSLevel(ch, 0, fftSize) / block.getNumChannels();
+        }
+
+        frameEnergy[(size_t) frame] = frameRms;
+
+        if (framePeak > silenceThreshold)
+        {
+            if (firstAudible < 0)
+            {
+                for (int i = 0; i < fftSize && firstAudible < 0; ++i)
+                {
+                    for (int ch = 0; ch < block.getNumChannels(); ++ch)
+                    {
+                        if (std::abs(block.getSample(ch, i)) > silenceThreshold)
+                        {
+                            firstAudible = pos + i;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            // searched backwards, so for a loud frame this stops almost straight away
+            for (int i = fftSize - 1; i >= 0; --i)
+            {
+                bool audible = false;
+
+                for (int ch = 0; ch < block.getNumChannels(); ++ch)
+                {
+                    audible = audible || std::abs(block.getSample(ch, i)) > silenceThreshold;
+                }
+
+                if (audible)
+                {
+                    lastAudible = pos + i;
+                    break;
+                }
+            }
+        }
+
+        // mono mix, windowed and transformed to magnitudes in place
+        FloatVectorOperations::copy(fftData.data(), block.getReadPointer(0), fftSize);
+        if (block.getNumChannels() > 1)
+        {
+            FloatVectorOperations::add(fftData.data(), block.getReadPointer(1), fftSize);
+            FloatVectorOperations::multiply(fftData.data(), 0.5f, fftSize);
+        }
+
+        // collected until a whole key frame is ready, then transformed and added to the running sum
+        int keySlot = (int) (frame % framesPerKeyFrame);
+        FloatVectorOperations::copy(keyInput.data() + keySlot * fftSize, fftData.data(), fftSize);
+
+        if (keySlot == framesPerKeyFrame - 1 && framePeak > silenceThreshold)
+        {
+            FloatVectorOperations::copy(keyData.data(), keyInput.data(), keyFftSize);
+            keyWindow.multiplyWithWindowingTable(keyData.data(), (size_t) keyFftSize);
+            keyFft.performFrequencyOnlyForwardTransform(keyData.data());
+            FloatVectorOperations::add(keySpectrum.data(), keyData.data(), keyFftSize / 2);
+        }
+
+        window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+        fft.performFrequencyOnlyForwardTransform(fftData.data());
+        FloatVectorOperations::multiply(fftData.data(), fftData.data(), fftSize / 2);
+
+        const float* power = fftData.data();
+        int column = (int) (frame * columns / numFrames);
+        double* bands = &energy[(size_t) (column * TrackAnalysis::numBands)];
+
+        bands[TrackAnalysis::low] += std::accumulate(power + 1, power + lowEnd, 0.0);
+        bands[TrackAnalysis::mid] += std::accumulate(power + lowEnd, power + midEnd, 0.0);
+        bands[TrackAnalysis::high] += std::accumulate(power + midEnd, power + fftSize / 2, 0.0);
+        ++framesPerColumn[(size_t) column];
+    }
+
+    // rms per column, then scaled against the loudest band anywhere in the track so
+    // the bands keep their relative weight
+    double loudest = 0.0;
+
+    for (int c = 0; c < columns; ++c)
+    {
+        for (int b = 0; b < TrackAnalysis::numBands; ++b)
+        {
+            double& e = energy[(size_t) (c * TrackAnalysis::numBands + b)];
+            e = std::sqrt(e / jmax(1, framesPerColumn[(size_t) c]));
+            loudest = jmax(loudest, e);
+        }
+    }
+
+    auto analysis = std::make_shared<TrackAnalysis>();
+    analysis->bandLevels.resize(energy.size());
+    analysis->sampleRate = reader.sampleRate;
+    analysis->lengthInSamples = reader.lengthInSamples;
+
+    // a track that is silent throughout keeps its full length
+    analysis->firstAudibleSample = firstAudible >= 0 ? firstAudible : 0;
+    analysis->lastAudibleSample = lastAudible >= 0 ? jmin(lastAudible, reader.lengthInSamples - 1) : reader.lengthInSamples - 1;
+    findIntroAndOutro(*analysis, frameEnergy, fftSize);
+    findFingerprint(*analysis, energy, (numFrames * fftSize) / columns);
+    findKey(*analysis, keySpectrum, keyFftSize);
+
+    for (size_t i = 0; i < energy.size(); ++i)
+    {
+        // square root curve so quiet detail is still visible next to the bass
+        double level = loudest > 0.0 ? std::sqrt(energy[i] / loudest) : 0.0;
+        analysis->bandLevels[i] = (uint8) jlimit(0, 255, (int) (level * 255.0));
+    }
+
+    return analysis;
+}
+
+void TrackAnalyser::findFingerprint(TrackAnalysis& analysis, const std::vector<double>& columnEnergy, int64 samplesPerColumn)
+{
+    const int numSteps = 32;
+    const int numPairs = TrackAnalysis::numBands - 1;
+
+    int numColumns = (int) columnEnergy.size() / TrackAnalysis::numBands;
+    int first = (int) jmin((int64) numColumns - 1, analysis.firstAudibleSample / jmax((int64) 1, samplesPerColumn));
+    int last = (int) jmin((int64) numColumns - 1, analysis.lastAudibleSample / jmax((int64) 1, samplesPerColumn));
+    int audibleColumns = last - first + 1;
+
+    // only the audible part counts, so a copy with more or less silence at either end still matches
+    if (audibleColumns < numSteps + 1)
+    {
+        return;
+    }
+
+    // band energy summed over each of the numSteps + 1 stretches
+    std::vector<double> stretches((size_t) ((numSteps + 1) * TrackAnalysis::numBands), 0.0);
+
+    for (int c = first; c <= last; ++c)
+    {
+        int stretch = (c - first) * (numSteps + 1) / audibleColumns;
+
+        for (int b = 0; b < TrackAnalysis::numBands; ++b)
+        {
+            stretches[(size_t) (stretch * TrackAnalysis::numBands + b)] += columnEnergy[(size_t) (c * TrackAnalysis::numBands + b)];
+        }
+    }
+
+    // a bit is set when the difference between two bands grows from one stretch to the next. only the
+    // signs of differences are kept, so the level the track was mastered or encoded at does not matter
+    uint64 bits = 0;
+
+    for (int step = 0; step < numSteps; ++step)
+    {
+        const double* before = &stretches[(size_t) (step * TrackAnalysis::numBands)];
+        const double* after = before + TrackAnalysis::numBands;
+
+        for (int pair = 0; pair < numPairs; ++pair)
+        {
+            double change = (after[pair] - after[pair + 1]) - (before[pair] - before[pair + 1]);
+
+            if (change > 0.0)
+            {
+                bits |= (uint64) 1 << (step * numPairs + pair);
+            }
+        }
+    }
+
+    analysis.fingerprint = bits;
+    analysis.hasFingerprint = true;
+}
+
+void TrackAnalyser::findKey(TrackAnalysis& analysis, const std::vector<float>& keySpectrum, int keyFftSize)
+{
+    // Krumhansl-Kessler key profiles, how strongly each degree of the scale is heard in a major and a minor key
+    static const double majorProfile[12] = { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 };
+    static const double minorProfile[12] = { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 };
+
+    // each bin from 100Hz to 5kHz goes to the pitch class of the nearest note. below that the bins are
+    // wider than a semitone, above it the harmonics blur the picture
+    double binHz = analysis.sampleRate / keyFftSize;
+    int firstBin = jmax(1, (int) std::ceil(100.0 / binHz));
+    int lastBin = jmin((int) keySpectrum.size() - 1, (int) (5000.0 / binHz));
+
+    std::array<double, 12> chroma{};
+
+    for (int bin = firstBin; bin <= lastBin; ++bin)
+    {
+        int note = (int) std::round(69.0 + 12.0 * std::log2(bin * binHz / 440.0));
+        chroma[(size_t) (note % 12)] += keySpectrum[(size_t) bin];
+    }
+
+    double chromaMean = std::accumulate(chroma.begin(), chroma.end(), 0.0) / 12.0;
+    if (chromaMean <= 0.0)
+    {
+        return;
+    }
+
+    // the key is whichever of the 24 rotated profiles correlates best with the chroma
+    auto correlate = [&chroma, chromaMean](const double* profile, int tonic)
+    {
+        double profileMean = std::accumulate(profile, profile + 12, 0.0) / 12.0;
+        double sumProduct = 0.0;
+        double sumChroma = 0.0;
+        double sumProfile = 0.0;
+
+        for (int i = 0; i < 12; ++i)
+        {
+            double c = chroma[(size_t) ((tonic + i) % 12)] - chromaMean;
+            double p = profile[i] - profileMean;
+
+            sumProduct += c * p;
+            sumChroma += c * c;
+            sumProfile += p * p;
+        }
+
+        return sumChroma > 0.0 ? sumProduct / std::sqrt(sumChroma * sumProfile) : 0.0;
+    };
+
+    double best = 0.0;
+
+    for (int tonic = 0; tonic < 12; ++tonic)
+    {
+        double major = correlate(majorProfile, tonic);
+        double minor = correlate(minorProfile, tonic);
+
+        if (major > best)
+        {
+            best = major;
+            analysis.camelotKey = HarmonicIndex::getKeyFromTonic(tonic, true);
+        }
+
+        if (minor > best)
+        {
+            best = minor;
+            analysis.camelotKey = HarmonicIndex::getKeyFromTonic(tonic, false);
+        }
+    }
+}
+
+void TrackAnalyser::findIntroAndOutro(TrackAnalysis& analysis, const std::vector<float>& frameEnergy, int frameSize)
+{
+    int first = (int) (analysis.firstAudibleSample / frameSize);
+    int last = (int) jmin((int64) frameEnergy.size() - 1, analysis.lastAudibleSample / frameSize);
+
+    analysis.introEndSample = analysis.firstAudibleSample;
+    analysis.outroStartSample = analysis.lastAudibleSample;
+
+    if (last <= first)
+    {
+        return;
+    }
+
+    // energy averaged over about four seconds, so a single hit does not end the intro
+    int window = jmax(1, (int) (4.0 * analysis.sampleRate / frameSize));
+    std::vector<float> smoothed(frameEnergy.size(), 0.0f);
+    double runningSum = 0.0;
+    double totalSum = 0.0;
+
+    for (int f = first; f <= last; ++f)
+    {
+        runningSum += frameEnergy[(size_t) f];
+        if (f - first >= window)
+        {
+            runningSum -= frameEnergy[(size_t) (f - window)];
+        }
+
+        smoothed[(size_t) f] = (float) (runningSum / jmin(window, f - first + 1));
+        totalSum += frameEnergy[(size_t) f];
+    }
+
+    float average = (float) (totalSum / (last - first + 1));
+
+    // the moving average lags by half a window, which is taken back off the intro end
+    for (int f = first; f <= last; ++f)
+    {
+        if (smoothed[(size_t) f] >= average)
+        {
+            analysis.introEndSample = jmax(analysis.firstAudibleSample, (int64) (f - window / 2) * frameSize);
+            break;
+        }
+    }
+
+    for (int f = last; f >= first; --f)
+    {
+        if (smoothed[(size_t) f] >= average)
+        {
+            analysis.outroStartSample = jmin(analysis.lastAudibleSample, (int64) (f - window / 2) * frameSize);
+            break;
+        }
+    }
+}
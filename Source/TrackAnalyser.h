@@ -0,0 +1,132 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TrackMetadataService.h"
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/*
+    Everything the background analysis pass learns about a track.
+*/
+struct TrackAnalysis
+{
+    enum Band { low = 0, mid, high, numBands };
+
+    /** low, mid and high energy for each waveform column, interleaved, scaled to 0-255 */
+    std::vector<uint8> bandLevels;
+
+    double sampleRate = 0.0;
+    int64 lengthInSamples = 0;
+
+    // everything before firstAudibleSample and after lastAudibleSample is below the silence threshold
+    int64 firstAudibleSample = 0;
+    int64 lastAudibleSample = 0;
+
+    // the intro runs until the track first reaches its average loudness, the outro from the last time it does
+    int64 introEndSample = 0;
+    int64 outroStartSample = 0;
+
+    // how the balance between neighbouring bands moves across the audible part of the track, one bit per
+    // band pair per step. different encodes of the same recording land within a few bits of each other
+    uint64 fingerprint = 0;
+    bool hasFingerprint = false;
+
+    // Camelot wheel position of the key, as used by HarmonicIndex. -1 when no key could be found
+    int camelotKey = -1;
+
+    int getNumColumns() const;
+
+    /** band level of a column as 0-1 */
+    float getLevel(int column, Band band) const;
+
+    double samplesToSeconds(int64 samples) const;
+};
+
+//==============================================================================
+/*
+    Runs track analysis on a pool of background threads. The file is streamed
+    through the decoder once. Each frame is checked for silence and its energy
+    kept for intro/outro detection, then mixed to mono and split into
+    frequency bands with an FFT. Every four frames also go through a longer FFT
+    whose magnitudes are summed over the track, and the sum is folded into
+    pitch classes to find the key. The most recently used results are cached
+    per file, so a track loaded a second time is not analysed again.
+*/
+class TrackAnalyser
+{
+public:
+    using Callback = std::function<void(std::shared_ptr<const TrackAnalysis>)>;
+
+    static constexpr int numColumns = 1024;
+
+    /** anything quieter than this (about -60dBFS) counts as silence */
+    static constexpr float silenceThreshold = 0.001f;
+
+    TrackAnalyser(TrackMetadataService& _metadataService);
+    ~TrackAnalyser();
+
+    /** calls back on the message thread once the track has been analysed. the result is nullptr if the file could not be read.
+        a file already being analysed is not queued again, the callback waits on the running job */
+    void requestAnalysis(const File& file, Callback callback);
+
+    /** the cached result for a file, or nullptr if it has not been analysed yet */
+    std::shared_ptr<const TrackAnalysis> getCachedAnalysis(const File& file) const;
+
+    /** forgets the result for a file that has changed on disk, so it is analysed again next time. anyone still
+        waiting on the old contents is called back with the new analysis instead */
+    void invalidate(const File& file);
+
+    /** runs the analysis on the calling thread. shouldExit is polled between blocks */
+    static std::shared_ptr<TrackAnalysis> analyse(AudioFormatReader& reader, std::function<bool()> shouldExit);
+
+private:
+    class AnalysisJob;
+
+    /** everyone waiting on one job. the generation tells a job whether it is still the latest for its file */
+    struct Request
+    {
+        int generation;
+        std::vector<Callback> callbacks;
+    };
+
+    /** queues a job for a file that has no request in flight. cacheLock must be held */
+    void startRequest(const File& file, std::vector<Callback> callbacks);
+
+    /** fills in the intro and outro from the energy of each frame */
+    static void findIntroAndOutro(TrackAnalysis& analysis, const std::vector<float>& frameEnergy, int frameSize);
+
+    /** fills in the fingerprint from the band energy of each column */
+    static void findFingerprint(TrackAnalysis& analysis, const std::vector<double>& columnEnergy, int64 samplesPerColumn);
+
+    /** fills in the key from the magnitude spectrum summed over the track */
+    static void findKey(TrackAnalysis& analysis, const std::vector<float>& keySpectrum, int keyFftSize);
+
+    void storeResult(const File& file, std::shared_ptr<const TrackAnalysis> analysis);
+
+    TrackMetadataService& metadataService;
+
+    // a few MB at most, importing a large library would otherwise keep every track's analysis around
+    static constexpr size_t maxCachedAnalyses = 256;
+
+    // most recently used at the front. looking a result up moves it there, hence mutable
+    using CacheEntry = std::pair<String, std::shared_ptr<const TrackAnalysis>>;
+    mutable std::list<CacheEntry> cache;
+    std::map<String, std::list<CacheEntry>::iterator> cacheIndex;
+
+    // files with a job queued or running. invalidate replaces a file's request with a newer generation, and a
+    // job whose generation is no longer the file's drops its result without caching it or calling back
+    std::map<String, std::shared_ptr<Request>> inFlight;
+    int lastGeneration = 0;
+
+    // guards the cache, inFlight and lastGeneration
+    CriticalSection cacheLock;
+
+    // declared last so it is destroyed first, stopping jobs before the cache goes away
+    ThreadPool pool{ jmax(1, SystemStats::getNumCpus() - 1) };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackAnalyser)
+};
@@ -0,0 +1,212 @@
+#include "TrackMetadataService.h"
+
+//==============================================================================
+PreviewPlayer::PreviewPlayer(TimeSliceThread& _readAheadThread) : readAheadThread(_readAheadThread)
+{
+    readAheadThread.addTimeSliceClient(&ring);
+}
+
+PreviewPlayer::~PreviewPlayer()
+{
+    stop();
+    readAheadThread.removeTimeSliceClient(&ring);
+}
+
+void PreviewPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    ignoreUnused(samplesPerBlockExpected);
+    outputRate = sampleRate;
+}
+
+void PreviewPlayer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    ring.startBlock();
+    int number = previewNumber.load();
+
+    // a preview started during this block is played from the next, once the ring has switched to it
+    if (!loaded.load() || finishedNumber.load() == number || ring.hasPendingReader())
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    if (number != playingNumber)
+    {
+        playingNumber = number;
+        position = 0.0;
+    }
+
+    double sourceRate = ring.getSampleRate();
+    double end = jmin((double) ring.getLengthInSamples(), maxPreviewSeconds * sourceRate);
+
+    // silent from the end until the timer has caught up and unloaded it
+    if (sourceRate <= 0.0 || position >= end)
+    {
+        finishedNumber.store(number);
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    double step = sourceRate / outputRate;
+    ring.render(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples, position, step, step);
+
+    // a preview started during this block has already put the playhead at its own start
+    if (previewNumber.load() == number)
+    {
+        ring.setPlayhead(position);
+    }
+}
+
+void PreviewPlayer::releaseResources()
+{
+}
+
+void PreviewPlayer::preview(const File& file, std::unique_ptr<AudioFormatReader> reader)
+{
+    if (reader == nullptr)
+    {
+        return;
+    }
+
+    // the new reader and its read position are in place before the new number is published, so the audio
+    // thread never plays the new track from the old position or ends it on the old one's length
+    ring.setReader(reader.release());
+    ring.setPlayhead(0.0);
+    ring.setFilling(true);
+    currentFile = file;
+
+    ++previewNumber;
+    loaded.store(true);
+    startTimer(100);
+}
+
+void PreviewPlayer::stop()
+{
+    stopTimer();
+    loaded.store(false);
+    ring.setFilling(false);
+    ring.setReader(nullptr);
+    currentFile = File();
+}
+
+bool PreviewPlayer::isPreviewing(const File& file) const
+{
+    return loaded.load() && currentFile == file;
+}
+
+void PreviewPlayer::timerCallback()
+{
+    // a short track ends on its own, a long one is cut off at the limit
+    if (finishedNumber.load() == previewNumber.load())
+    {
+        stop();
+    }
+}
+
+//==============================================================================
+TrackMetadataService::TrackMetadataService()
+{
+    // only the fastest decoder available for each extension ends up in the manager
+    decoderRegistry.addBuiltInBackends();
+    decoderRegistry.registerInto(formatManager);
+
+    previewThread.startThread();
+}
+
+TrackMetadataService::~TrackMetadataService()
+{
+    previewPlayer.stop();
+    previewThread.stopThread(1000);
+}
+
+AudioFormatManager& TrackMetadataService::getFormatManager()
+{
+    return formatManager;
+}
+
+const DecoderRegistry& TrackMetadataService::getDecoderRegistry() const
+{
+    return decoderRegistry;
+}
+
+PreviewPlayer& TrackMetadataService::getPreviewPlayer()
+{
+    return previewPlayer;
+}
+
+bool TrackMetadataService::readMetadata(const File& file, TrackMetadata& result)
+{
+    auto reader = takeReader(file);
+
+    if (reader == nullptr || reader->sampleRate <= 0)
+    {
+        return false;
+    }
+
+    result.sampleRate = reader->sampleRate;
+    result.numChannels = (int) reader->numChannels;
+    result.lengthInSeconds = reader->lengthInSamples / reader->sampleRate;
+
+    returnReader(file, std::move(reader));
+    return true;
+}
+
+std::unique_ptr<AudioFormatReader> TrackMetadataService::takeReader(const File& file)
+{
+    {
+        const ScopedLock sl(poolLock);
+
+        String path = file.getFullPathName();
+
+        for (auto it = readerPool.begin(); it != readerPool.end(); ++it)
+        {
+            if (it->first == path)
+            {
+                auto reader = std::move(it->second);
+                readerPool.erase(it);
+                return reader;
+            }
+        }
+    }
+
+    // opening a decoder is the expensive part, done outside the lock
+    return std::unique_ptr<AudioFormatReader>(formatManager.createReaderFor(file));
+}
+
+void TrackMetadataService::returnReader(const File& file, std::unique_ptr<AudioFormatReader> reader)
+{
+    if (reader == nullptr)
+    {
+        return;
+    }
+
+    const ScopedLock sl(poolLock);
+
+    readerPool.emplace_front(file.getFullPathName(), std::move(reader));
+
+    // least recently used readers are closed first
+    while ((int) readerPool.size() > maxPooledReaders)
+    {
+        readerPool.pop_back();
+    }
+}
+
+void TrackMetadataService::invalidate(const File& file)
+{
+    const ScopedLock sl(poolLock);
+
+    String path = file.getFullPathName();
+    readerPool.remove_if([&path](const auto& pooled) {return pooled.first == path;});
+}
+
+void TrackMetadataService::togglePreview(const File& file)
+{
+    if (previewPlayer.isPreviewing(file))
+    {
+        previewPlayer.stop();
+    }
+    else
+    {
+        previewPlayer.preview(file, takeReader(file));
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DecoderRegistry.h"
+#include "ScratchBuffer.h"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <utility>
+
+//==============================================================================
+/*
+    Basic information read from a track's header.
+*/
+struct TrackMetadata
+{
+    double lengthInSeconds = 0.0;
+    double sampleRate = 0.0;
+    int numChannels = 0;
+};
+
+//==============================================================================
+/*
+    Cheap library preview. Plays the first few seconds of a track from a ring
+    decoded ahead on a background thread, the same one vinyl and low latency
+    decks play from, so the audio thread never locks or waits on the disk. It
+    unloads itself once maxPreviewSeconds have played. MainComponent routes it
+    to the cue bus so it is only heard in the headphones.
+*/
+class PreviewPlayer : public AudioSource, private Timer
+{
+public:
+    static constexpr double maxPreviewSeconds = 30.0;
+
+    PreviewPlayer(TimeSliceThread& _readAheadThread);
+    ~PreviewPlayer() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /** starts previewing, taking ownership of the reader */
+    void preview(const File& file, std::unique_ptr<AudioFormatReader> reader);
+    void stop();
+
+    bool isPreviewing(const File& file) const;
+
+private:
+    /** stops the preview once it has run its length, from the message thread */
+    void timerCallback() override;
+
+    TimeSliceThread& readAheadThread;
+
+    // one pair, and only a few seconds around the playhead since a preview never scratches. about 1MB
+    ScratchBuffer ring{ 1, 1 << 17 };
+    File currentFile;
+
+    // each preview gets a new number, so the audio thread knows to start again from the top
+    std::atomic<bool> loaded{ false };
+    std::atomic<int> previewNumber{ 0 };
+
+    // the number of the last preview the audio thread played to its end, so a stale one never stops a new one
+    std::atomic<int> finishedNumber{ -1 };
+
+    // audio thread only
+    int playingNumber = 0;
+    double position = 0.0;
+    double outputRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PreviewPlayer)
+};
+
+//==============================================================================
+/*
+    Shared by everything that needs to look inside audio files. Holds the one
+    format registry for the app, a small pool of open readers so a file looked
+    at again is not reopened, and the library preview player.
+*/
+class TrackMetadataService
+{
+public:
+    TrackMetadataService();
+    ~TrackMetadataService();
+
+    AudioFormatManager& getFormatManager();
+    const DecoderRegistry& getDecoderRegistry() const;
+    PreviewPlayer& getPreviewPlayer();
+
+    /** reads only the header of the file. returns false if no format could open it */
+    bool readMetadata(const File& file, TrackMetadata& result);
+
+    /** gets a reader for a file, reusing a pooled one when available. may return nullptr */
+    std::unique_ptr<AudioFormatReader> takeReader(const File& file);
+
+    /** gives a reader back to the pool once the caller is finished with it */
+    void returnReader(const File& file, std::unique_ptr<AudioFormatReader> reader);
+
+    /** closes any pooled reader for a file that has changed on disk */
+    void invalidate(const File& file);
+
+    /** previews a file in the headphones, or stops it if it is already previewing */
+    void togglePreview(const File& file);
+
+private:
+    static constexpr int maxPooledReaders = 8;
+
+    DecoderRegistry decoderRegistry;
+    AudioFormatManager formatManager;
+
+    // shared by every preview, so a new one never starts a thread of its own
+    TimeSliceThread previewThread{ "Preview Read Ahead" };
+    PreviewPlayer previewPlayer{ previewThread };
+
+    // most recently returned readers at the front
+    std::list<std::pair<String, std::unique_ptr<AudioFormatReader>>> readerPool;
+    CriticalSection poolLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackMetadataService)
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+//==============================================================================
+/*
+    Hands the latest value from one writer thread to one reader thread without
+    locks. The writer always has a slot of its own to fill, the reader always
+    has a stable slot to look at, and the third slot is swapped between them
+    with a single atomic exchange. The reader simply sees the newest complete
+    value. Older values it never looked at are dropped.
+*/
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    /** writer: the slot to fill before calling publish() */
+    T& getWriteBuffer()
+    {
+        return buffers[writeIndex];
+    }
+
+    /** writer: makes the write slot visible to the reader and takes the spare one */
+    void publish()
+    {
+        writeIndex = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /** reader: swaps in the newest value if there is one. returns true if it changed */
+    bool update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+        {
+            return false;
+        }
+
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    /** reader: the value swapped in by the last update() */
+    const T& getReadBuffer() const
+    {
+        return buffers[readIndex];
+    }
+
+private:
+    static constexpr int freshBit = 4;
+    static constexpr int indexMask = 3;
+
+    T buffers[3]{};
+    std::atomic<int> middle{ 1 };
+    int writeIndex = 0;
+    int readIndex = 2;
+};
@@ -2,7 +2,7 @@
 #include "WaveformDisplay.h"
 
 //==============================================================================
-WaveformDisplay::WaveformDisplay(AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse) : audioThumb(1000, formatManagerToUse, cacheToUse), fileLoaded(false), position(0)
+WaveformDisplay::WaveformDisplay(AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse, TrackAnalyser& analyserToUse) : audioThumb(1000, formatManagerToUse, cacheToUse), analyser(analyserToUse), fileLoaded(false), position(0)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
@@ -23,7 +23,15 @@ void WaveformDisplay::paint (juce::Graphics& g)
     if (fileLoaded)
     {
         // draws and sets the player head at the start of the waveform window
-        audioThumb.drawChannel(g, getLocalBounds(), 0, audioThumb.getTotalLength(), 0, 1.0f);
+        // the plain thumbnail is only a stand in until the band analysis is ready
+        if (bandAnalysis != nullptr)
+        {
+            paintBands(g, *bandAnalysis);
+        }
+        else
+        {
+            audioThumb.drawChannel(g, getLocalBounds(), 0, audioThumb.getTotalLength(), 0, 1.0f);
+        }
 
         g.setColour(Colours::lightgreen);
         g.fillRect(position * getWidth(), 0, getWidth() / 100, getHeight());
@@ -36,16 +44,104 @@ void WaveformDisplay::paint (juce::Graphics& g)
     }
 }
 
+void WaveformDisplay::paintBands(juce::Graphics& g, const TrackAnalysis& analysis)
+{
+    int columns = analysis.getNumColumns();
+    if (columns == 0)
+    {
+        return;
+    }
+
+    float midY = getHeight() / 2.0f;
+    const Colour bandColours[] = { Colours::red, Colours::orange, Colours::white };
+
+    // lows are drawn first as the widest layer, highs last on top
+    for (int band = TrackAnalysis::low; band < TrackAnalysis::numBands; ++band)
+    {
+        g.setColour(bandColours[band].withAlpha(0.85f));
+
+        for (int x = 0; x < getWidth(); ++x)
+        {
+            int column = x * columns / getWidth();
+            float h = analysis.getLevel(column, (TrackAnalysis::Band) band) * midY;
+            g.fillRect((float) x, midY - h, 1.0f, h * 2.0f);
+        }
+    }
+
+    if (analysis.lengthInSamples <= 0)
+    {
+        return;
+    }
+
+    auto toX = [this, &analysis](int64 sample) { return (float) ((double) sample * getWidth() / (double) analysis.lengthInSamples); };
+
+    // leading and trailing silence is shaded, the end of the intro and start of the outro are marked
+    g.setColour(Colours::black.withAlpha(0.5f));
+    g.fillRect(0.0f, 0.0f, toX(analysis.firstAudibleSample), (float) getHeight());
+    g.fillRect(toX(analysis.lastAudibleSample), 0.0f, (float) getWidth() - toX(analysis.lastAudibleSample), (float) getHeight());
+
+    g.setColour(Colours::cyan);
+    g.drawVerticalLine((int) toX(analysis.introEndSample), 0.0f, (float) getHeight());
+    g.drawVerticalLine((int) toX(analysis.outroStartSample), 0.0f, (float) getHeight());
+}
+
 void WaveformDisplay::resized()
 {
 }
 
+void WaveformDisplay::mouseDown(const MouseEvent& event)
+{
+    lastDragX = event.x;
+
+    if (onTouch != nullptr)
+    {
+        onTouch();
+    }
+}
+
+void WaveformDisplay::mouseDrag(const MouseEvent& event)
+{
+    int moved = event.x - lastDragX;
+    lastDragX = event.x;
+
+    if (moved != 0 && onDrag != nullptr)
+    {
+        onDrag(moved);
+    }
+}
+
+void WaveformDisplay::mouseUp(const MouseEvent& event)
+{
+    if (onRelease != nullptr)
+    {
+        onRelease();
+    }
+}
+
 void WaveformDisplay::loadURL(URL audioURL)
 {
     audioThumb.clear();
+    bandAnalysis.reset();
+    currentURL = audioURL;
 
     fileLoaded = audioThumb.setSource(new URLInputSource(audioURL));
 
+    // the band analysis decodes on a background thread and is swapped in when it arrives
+    if (audioURL.isLocalFile())
+    {
+        Component::SafePointer<WaveformDisplay> safeThis(this);
+
+        analyser.requestAnalysis(audioURL.getLocalFile(), [safeThis, audioURL](std::shared_ptr<const TrackAnalysis> analysis)
+        {
+            // ignore results for a track that has since been replaced
+            if (safeThis != nullptr && safeThis->currentURL == audioURL)
+            {
+                safeThis->bandAnalysis = analysis;
+                safeThis->repaint();
+            }
+        });
+    }
+
     if (fileLoaded)
     {
         std::cout << "wdf: loaded!" << std::endl;
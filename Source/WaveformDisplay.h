@@ -1,6 +1,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "TrackAnalyser.h"
 
 //==============================================================================
 /*
@@ -8,7 +9,7 @@
 class WaveformDisplay  : public juce::Component, public juce::ChangeListener
 {
 public:
-    WaveformDisplay(AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse);
+    WaveformDisplay(AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse, TrackAnalyser& analyserToUse);
     ~WaveformDisplay() override;
 
     void paint (juce::Graphics&) override;
@@ -21,10 +22,29 @@ public:
     /** set the relative position of the playhead*/
     void setPositionRelative(double pos);
 
+    void mouseDown(const MouseEvent& event) override;
+    void mouseDrag(const MouseEvent& event) override;
+    void mouseUp(const MouseEvent& event) override;
+
+    /** holding and dragging the waveform, with the drag in pixels since the last call. used for scratching */
+    std::function<void()> onTouch;
+    std::function<void(int)> onDrag;
+    std::function<void()> onRelease;
+
 private:
+    /** draws the low, mid and high bands on top of each other, each in its own colour */
+    void paintBands(juce::Graphics& g, const TrackAnalysis& analysis);
+
     AudioThumbnail audioThumb;
+    TrackAnalyser& analyser;
+
+    // shown instead of the plain thumbnail once the background analysis has finished
+    std::shared_ptr<const TrackAnalysis> bandAnalysis;
+    URL currentURL;
+
     bool fileLoaded;
     double position;
+    int lastDragX = 0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformDisplay)
 };